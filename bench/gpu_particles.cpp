@@ -0,0 +1,79 @@
+// Transform-feedback particle throughput at increasing particle counts.
+// Only the update pass is timed, drawing depends on fill rate and screen size.
+// Run from bin/ so the shader paths resolve, like the game itself. Skipped
+// without a GL context, like the suite's GL scenarios.
+
+#include "../src/gl_state_cache.h"
+#include "../src/gpu_particles.h"
+#include "../src/shader.h"
+
+#include <GL/glew.h>
+#include <SDL3/SDL.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+static constexpr int WARMUP_FRAMES = 5;
+static constexpr int TIMED_FRAMES = 50;
+
+int main()
+{
+  auto skip = []
+  {
+    std::cerr << "WARNING::BENCH::NO_GL_CONTEXT skipping gpu_particles " << SDL_GetError() << std::endl;
+    return 0;
+  };
+
+  if (!SDL_Init(SDL_INIT_VIDEO)) return skip();
+
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+
+  SDL_Window* window = SDL_CreateWindow("bench_gpu_particles", 64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+  if (window == nullptr) return skip();
+
+  SDL_GLContext opengl_context = SDL_GL_CreateContext(window);
+  if (opengl_context == nullptr || glewInit() != GLEW_OK) return skip();
+
+  const char* varyings[] = { "o_position_size", "o_velocity_life", "o_color", "o_params" };
+  unsigned int update_program = Shader::load_feedback_program("../res/shaders/particle_update.vert", varyings, 4);
+
+  std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+  std::cout << "particles      ms/update  Mparticles/s" << std::endl;
+
+  const uint32_t counts[] = { 16384, 65536, 262144, 1048576 };
+  for (uint32_t count : counts)
+  {
+    GLStateCache state;
+    GpuParticles particles;
+    particles.init(state, count, update_program, 0);
+
+    // Fill every slot, lifetime long enough that nothing dies mid-run.
+    ParticleBurst burst;
+    burst.count = count;
+    burst.lifetime = 1000.0f;
+    particles.spawn(state, burst);
+
+    for (int i = 0; i < WARMUP_FRAMES; ++i) particles.update(state, 1.0f / 60.0f);
+    glFinish();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < TIMED_FRAMES; ++i) particles.update(state, 1.0f / 60.0f);
+    glFinish();
+    auto end = std::chrono::steady_clock::now();
+
+    double ms = std::chrono::duration<double, std::milli>(end - start).count() / TIMED_FRAMES;
+    double rate = particles.get_active_count() / (ms * 1000.0);
+    std::cout << count << "\t\t" << ms << "\t\t" << rate << std::endl;
+
+    particles.destroy();
+  }
+
+  glDeleteProgram(update_program);
+  SDL_GL_DestroyContext(opengl_context);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return 0;
+}
@@ -0,0 +1,148 @@
+// Stress test for the job system: batches that depend on other batches,
+// submitted at the same time from the main thread (worker 0), from inside
+// running jobs (other workers) and from a thread that isn't a worker. Every
+// job must run exactly once and never before its dependency; a lost job shows
+// up as a wait() that never returns, which the watchdog turns into a failure.
+
+#include "../src/job_system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+static constexpr int DEFAULT_ROUNDS = 4000;
+static constexpr int BATCH_SIZE = 16;
+static constexpr int STALL_SECONDS = 5;
+
+struct Round
+{
+  JobSystem* system = nullptr;
+  JobCounter first;
+  JobCounter second;
+  JobCounter third;
+  Job first_jobs[BATCH_SIZE];
+  Job second_jobs[BATCH_SIZE];
+  Job third_jobs[BATCH_SIZE];
+  std::atomic<int> first_done { 0 };
+  std::atomic<int> second_done { 0 };
+  std::atomic<int> third_done { 0 };
+  std::atomic<int> early { 0 };
+};
+
+static void first_job(void* p_data)
+{
+  Round& round = *static_cast<Round*>(p_data);
+  round.first_done.fetch_add(1);
+}
+
+// Runs the third batch from inside a worker, depending on the batch it is
+// part of.
+static void spawning_job(void* p_data)
+{
+  Round& round = *static_cast<Round*>(p_data);
+  round.system->run(round.third_jobs, BATCH_SIZE, &round.third);
+  round.first_done.fetch_add(1);
+}
+
+static void second_job(void* p_data)
+{
+  Round& round = *static_cast<Round*>(p_data);
+  if (round.first_done.load() != BATCH_SIZE) round.early.fetch_add(1);
+  round.second_done.fetch_add(1);
+}
+
+static void third_job(void* p_data)
+{
+  Round& round = *static_cast<Round*>(p_data);
+  if (round.first_done.load() != BATCH_SIZE) round.early.fetch_add(1);
+  round.third_done.fetch_add(1);
+}
+
+// --rounds N runs more rounds, for soaking on bigger machines.
+int main(int argc, char* argv[])
+{
+  int rounds = DEFAULT_ROUNDS;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg == "--rounds" && i + 1 < argc)
+    {
+      rounds = std::max(std::atoi(argv[++i]), 1);
+    }
+    else
+    {
+      std::cerr << "ERROR::JOB_STRESS::UNKNOWN_ARGUMENT " << arg << std::endl;
+      return 2;
+    }
+  }
+
+  // At least four workers even on small machines, the races need them.
+  JobSystem system { std::max(std::thread::hardware_concurrency(), 4u) };
+
+  std::atomic<int> progress { 0 };
+  std::atomic<bool> finished { false };
+  std::thread watchdog { [&]
+  {
+    int last = -1;
+    auto last_change = std::chrono::steady_clock::now();
+    while (!finished.load())
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds { 50 });
+      int now = progress.load();
+      if (now != last)
+      {
+        last = now;
+        last_change = std::chrono::steady_clock::now();
+      }
+      else if (std::chrono::steady_clock::now() - last_change > std::chrono::seconds { STALL_SECONDS })
+      {
+        std::cerr << "ERROR::JOB_STRESS::STALLED round " << now << std::endl;
+        std::_Exit(1);
+      }
+    }
+  } };
+
+  auto start = std::chrono::steady_clock::now();
+  int failures = 0;
+  for (int i = 0; i < rounds; ++i)
+  {
+    Round round;
+    round.system = &system;
+    for (int j = 0; j < BATCH_SIZE; ++j)
+    {
+      round.first_jobs[j] = { j == 0 ? spawning_job : first_job, &round };
+      round.second_jobs[j] = { second_job, &round, nullptr, &round.first };
+      round.third_jobs[j] = { third_job, &round, nullptr, &round.first };
+    }
+
+    // Dependents from a thread that isn't a worker while the batch they
+    // depend on is finishing on the workers. The third batch is submitted
+    // from inside that batch.
+    system.run(round.first_jobs, BATCH_SIZE, &round.first);
+    std::thread outside { [&] { system.run(round.second_jobs, BATCH_SIZE, &round.second); } };
+    outside.join();
+
+    system.wait(&round.first);
+    system.wait(&round.second);
+    system.wait(&round.third);
+
+    if (round.second_done.load() != BATCH_SIZE || round.third_done.load() != BATCH_SIZE || round.early.load() != 0)
+    {
+      std::cerr << "ERROR::JOB_STRESS::ROUND " << i << " second " << round.second_done.load() << " third " << round.third_done.load() << " early " << round.early.load() << std::endl;
+      failures++;
+    }
+    progress.store(i + 1);
+  }
+
+  finished.store(true);
+  watchdog.join();
+
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "job_stress: " << rounds << " rounds on " << system.get_thread_count() << " threads in " << ms << " ms, " << failures << " failures" << std::endl;
+  return failures > 0 ? 1 : 0;
+}
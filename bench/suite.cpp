@@ -0,0 +1,674 @@
+// Named benchmark scenarios with machine-readable results. Each scenario is
+// timed over a number of samples after a warmup; the median, percentiles and
+// variance go to a JSON file and are compared against a stored baseline.
+// Run from bin/ so asset paths resolve, like the game itself.
+//
+//   suite [--filter TEXT] [--out FILE] [--baseline FILE] [--update-baseline]
+//         [--threshold RATIO] [--threshold NAME=RATIO] [--min-delta-ms MS]
+//
+// A scenario regresses when its median is more than RATIO above the
+// baseline median (default 0.10) and by at least --min-delta-ms (default
+// 0.02), which keeps microsecond scenarios from failing on noise. Any
+// regression makes the exit code 1. The baseline defaults to
+// ../bench/baseline.json and is only compared when it exists;
+// --update-baseline overwrites it with this run. Baselines are per machine.
+// GL scenarios are skipped when no context can be created.
+
+#include "../src/bvh.h"
+#include "../src/culling.h"
+#include "../src/frame_arena.h"
+#include "../src/geometry_pool.h"
+#include "../src/gl_state_cache.h"
+#include "../src/job_system.h"
+#include "../src/level.h"
+#include "../src/mesh_loader.h"
+#include "../src/particle_system.h"
+#include "../src/render_queue.h"
+#include "../src/render_thread.h"
+#include "../src/shader.h"
+#include "../src/transform_hierarchy.h"
+#include "../src/uniform_buffers.h"
+
+#include <GL/glew.h>
+#include <SDL3/SDL.h>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static constexpr int WARMUP_RUNS = 2;
+
+struct BenchResult
+{
+  std::string name;
+  int samples = 0;
+  double median_ms = 0.0;
+  double p90_ms = 0.0;
+  double p99_ms = 0.0;
+  double mean_ms = 0.0;
+  // Of the sample times, ms squared.
+  double variance = 0.0;
+  double min_ms = 0.0;
+  double max_ms = 0.0;
+  double allocations = 0.0;
+};
+
+struct BaselineEntry
+{
+  std::string name;
+  double median_ms = 0.0;
+};
+
+struct Threshold
+{
+  std::string name;
+  double ratio = 0.0;
+};
+
+class BenchRunner
+{
+  public:
+  std::string filter;
+  std::vector<BenchResult> results;
+
+  bool enabled(const std::string& p_name) const { return filter.empty() || p_name.find(filter) != std::string::npos; }
+
+  template <typename F>
+  void measure(const std::string& p_name, int p_samples, const F& p_func);
+};
+
+template <typename F>
+void BenchRunner::measure(const std::string& p_name, int p_samples, const F& p_func)
+{
+  if (!enabled(p_name)) return;
+
+  for (int i = 0; i < WARMUP_RUNS; ++i) p_func();
+
+  std::vector<double> times(p_samples);
+  uint64_t heap_count = HeapCounter::get_count();
+  for (int i = 0; i < p_samples; ++i)
+  {
+    auto start = std::chrono::steady_clock::now();
+    p_func();
+    auto end = std::chrono::steady_clock::now();
+    times[i] = std::chrono::duration<double, std::milli>(end - start).count();
+  }
+  uint64_t allocations = HeapCounter::get_count() - heap_count;
+
+  std::sort(times.begin(), times.end());
+  auto percentile = [&](double p_fraction)
+  {
+    // Nearest rank.
+    size_t rank = (size_t)std::ceil(p_fraction * times.size());
+    return times[std::min(std::max<size_t>(rank, 1), times.size()) - 1];
+  };
+
+  BenchResult result;
+  result.name = p_name;
+  result.samples = p_samples;
+  size_t middle = times.size() / 2;
+  result.median_ms = times.size() % 2 ? times[middle] : (times[middle - 1] + times[middle]) * 0.5;
+  result.p90_ms = percentile(0.90);
+  result.p99_ms = percentile(0.99);
+  for (double time : times) result.mean_ms += time;
+  result.mean_ms /= times.size();
+  for (double time : times) result.variance += (time - result.mean_ms) * (time - result.mean_ms);
+  result.variance /= std::max<size_t>(times.size() - 1, 1);
+  result.min_ms = times.front();
+  result.max_ms = times.back();
+  result.allocations = (double)allocations / p_samples;
+  results.push_back(result);
+
+  printf("%-32s %10.4f %10.4f %10.4f %10.4f %8.0f\n", p_name.c_str(), result.median_ms, result.p90_ms, result.p99_ms, std::sqrt(result.variance), result.allocations);
+  fflush(stdout);
+}
+
+// Escaping is not needed for the strings written here, names and the GL
+// renderer string.
+static bool write_results(const std::string& p_path, const std::string& p_renderer, unsigned int p_threads, const std::vector<BenchResult>& p_results)
+{
+  std::ofstream out { p_path };
+  if (!out) return false;
+
+  char line[512];
+  out << "{\n";
+  out << "  \"version\": 1,\n";
+  out << "  \"renderer\": \"" << p_renderer << "\",\n";
+  out << "  \"threads\": " << p_threads << ",\n";
+  out << "  \"scenarios\": [\n";
+  for (size_t i = 0; i < p_results.size(); ++i)
+  {
+    const BenchResult& result = p_results[i];
+    snprintf(line, sizeof(line),
+        "    { \"name\": \"%s\", \"samples\": %d, \"median_ms\": %.6f, \"p90_ms\": %.6f, \"p99_ms\": %.6f, \"mean_ms\": %.6f, \"variance\": %.9f, \"min_ms\": %.6f, \"max_ms\": %.6f, \"allocations\": %.1f }%s\n",
+        result.name.c_str(), result.samples, result.median_ms, result.p90_ms, result.p99_ms, result.mean_ms, result.variance, result.min_ms, result.max_ms, result.allocations,
+        i + 1 < p_results.size() ? "," : "");
+    out << line;
+  }
+  out << "  ]\n";
+  out << "}\n";
+  return (bool)out;
+}
+
+static std::string read_string_field(const std::string& p_line, const char* p_key)
+{
+  std::string pattern = std::string { "\"" } + p_key + "\": \"";
+  size_t start = p_line.find(pattern);
+  if (start == std::string::npos) return {};
+  start += pattern.size();
+  size_t end = p_line.find('"', start);
+  return end == std::string::npos ? std::string {} : p_line.substr(start, end - start);
+}
+
+// Only reads the layout write_results() produces, one scenario per line.
+static bool read_baseline(const std::string& p_path, std::string& r_renderer, std::vector<BaselineEntry>& r_entries)
+{
+  std::ifstream in { p_path };
+  if (!in) return false;
+
+  std::string line;
+  while (std::getline(in, line))
+  {
+    std::string renderer = read_string_field(line, "renderer");
+    if (!renderer.empty()) r_renderer = renderer;
+
+    BaselineEntry entry;
+    entry.name = read_string_field(line, "name");
+    size_t median = line.find("\"median_ms\": ");
+    if (entry.name.empty() || median == std::string::npos) continue;
+    entry.median_ms = std::strtod(line.c_str() + median + 13, nullptr);
+    r_entries.push_back(entry);
+  }
+  return true;
+}
+
+// Regressions against the baseline, printed as a table.
+static int compare(const std::vector<BenchResult>& p_results, const std::vector<BaselineEntry>& p_baseline, double p_default_threshold, const std::vector<Threshold>& p_thresholds, double p_min_delta_ms)
+{
+  int regressions = 0;
+  printf("\n%-32s %10s %10s %8s %8s\n", "scenario", "baseline", "median", "change", "limit");
+  for (const BenchResult& result : p_results)
+  {
+    auto entry = std::find_if(p_baseline.begin(), p_baseline.end(), [&](const BaselineEntry& p_entry) { return p_entry.name == result.name; });
+    if (entry == p_baseline.end() || entry->median_ms <= 0.0)
+    {
+      printf("%-32s %10s %10.4f %8s %8s  new\n", result.name.c_str(), "-", result.median_ms, "-", "-");
+      continue;
+    }
+
+    double threshold = p_default_threshold;
+    for (const Threshold& override : p_thresholds)
+    {
+      if (override.name == result.name) threshold = override.ratio;
+    }
+
+    double change = result.median_ms / entry->median_ms - 1.0;
+    bool regressed = change > threshold && result.median_ms - entry->median_ms >= p_min_delta_ms;
+    if (regressed) regressions++;
+    printf("%-32s %10.4f %10.4f %+7.1f%% %7.1f%%  %s\n", result.name.c_str(), entry->median_ms, result.median_ms, change * 100.0, threshold * 100.0, regressed ? "REGRESSED" : "ok");
+  }
+  return regressions;
+}
+
+static std::string encode_base64(const unsigned char* p_data, size_t p_size)
+{
+  static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  out.reserve((p_size + 2) / 3 * 4);
+  for (size_t i = 0; i < p_size; i += 3)
+  {
+    uint32_t bits = (uint32_t)p_data[i] << 16;
+    if (i + 1 < p_size) bits |= (uint32_t)p_data[i + 1] << 8;
+    if (i + 2 < p_size) bits |= p_data[i + 2];
+    out += ALPHABET[bits >> 18 & 63];
+    out += ALPHABET[bits >> 12 & 63];
+    out += i + 1 < p_size ? ALPHABET[bits >> 6 & 63] : '=';
+    out += i + 2 < p_size ? ALPHABET[bits & 63] : '=';
+  }
+  return out;
+}
+
+// Grid of p_size x p_size vertices with positions, texture coordinates and
+// indices in one buffer, either embedded as a data URI or next to the .gltf.
+static bool write_grid_gltf(const std::string& p_path, uint32_t p_size, bool p_embedded)
+{
+  uint32_t vertex_count = p_size * p_size;
+  uint32_t index_count = (p_size - 1) * (p_size - 1) * 6;
+  std::vector<unsigned char> buffer(vertex_count * 20 + index_count * 4);
+  float* positions = reinterpret_cast<float*>(buffer.data());
+  float* tex_coords = positions + vertex_count * 3;
+  uint32_t* indices = reinterpret_cast<uint32_t*>(tex_coords + vertex_count * 2);
+
+  for (uint32_t y = 0; y < p_size; ++y)
+  {
+    for (uint32_t x = 0; x < p_size; ++x)
+    {
+      uint32_t vertex = y * p_size + x;
+      float u = (float)x / (p_size - 1);
+      float v = (float)y / (p_size - 1);
+      positions[vertex * 3 + 0] = u * 2.0f - 1.0f;
+      positions[vertex * 3 + 1] = std::sin(u * 12.0f) * std::cos(v * 12.0f) * 0.1f;
+      positions[vertex * 3 + 2] = v * 2.0f - 1.0f;
+      tex_coords[vertex * 2 + 0] = u;
+      tex_coords[vertex * 2 + 1] = v;
+    }
+  }
+  uint32_t* index = indices;
+  for (uint32_t y = 0; y + 1 < p_size; ++y)
+  {
+    for (uint32_t x = 0; x + 1 < p_size; ++x)
+    {
+      uint32_t corner = y * p_size + x;
+      *index++ = corner;
+      *index++ = corner + p_size;
+      *index++ = corner + 1;
+      *index++ = corner + 1;
+      *index++ = corner + p_size;
+      *index++ = corner + p_size + 1;
+    }
+  }
+
+  std::string uri;
+  if (p_embedded)
+  {
+    uri = "data:application/octet-stream;base64," + encode_base64(buffer.data(), buffer.size());
+  }
+  else
+  {
+    std::string bin_path = p_path.substr(0, p_path.size() - 5) + ".bin";
+    std::ofstream bin { bin_path, std::ios::binary };
+    bin.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    if (!bin) return false;
+    uri = std::filesystem::path { bin_path }.filename().string();
+  }
+
+  size_t positions_size = vertex_count * 12;
+  size_t tex_coords_size = vertex_count * 8;
+  char json[2048];
+  snprintf(json, sizeof(json),
+      "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+      "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"TEXCOORD_0\":1},\"indices\":2}]}],"
+      "\"accessors\":["
+      "{\"bufferView\":0,\"componentType\":5126,\"count\":%u,\"type\":\"VEC3\",\"min\":[-1,-0.1,-1],\"max\":[1,0.1,1]},"
+      "{\"bufferView\":1,\"componentType\":5126,\"count\":%u,\"type\":\"VEC2\"},"
+      "{\"bufferView\":2,\"componentType\":5125,\"count\":%u,\"type\":\"SCALAR\"}],"
+      "\"bufferViews\":["
+      "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%zu},"
+      "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},"
+      "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}],"
+      "\"buffers\":[{\"byteLength\":%zu,\"uri\":\"",
+      vertex_count, vertex_count, index_count,
+      positions_size,
+      positions_size, tex_coords_size,
+      positions_size + tex_coords_size, (size_t)index_count * 4,
+      buffer.size());
+
+  std::ofstream out { p_path, std::ios::binary };
+  out << json << uri << "\"}]}";
+  return (bool)out;
+}
+
+static void bench_asset_loads(BenchRunner& r_runner)
+{
+  r_runner.measure("asset_load_pyramid", 20, []
+  {
+    MeshData mesh = MeshLoader::load("../res/models/pyramid/pyramid.gltf");
+    if (mesh.indices.empty()) std::cerr << "ERROR::BENCH::LOAD_FAILED pyramid" << std::endl;
+  });
+
+  struct Synthetic
+  {
+    const char* name;
+    uint32_t size;
+    bool embedded;
+  };
+  const Synthetic synthetic[] = {
+    { "asset_load_gltf_64k_embedded", 256, true },
+    { "asset_load_gltf_1m", 1024, false },
+  };
+
+  std::string directory = (std::filesystem::temp_directory_path() / "bench_suite").string();
+  std::filesystem::create_directories(directory);
+  for (const Synthetic& entry : synthetic)
+  {
+    if (!r_runner.enabled(entry.name)) continue;
+    std::string path = directory + "/" + entry.name + ".gltf";
+    if (!write_grid_gltf(path, entry.size, entry.embedded))
+    {
+      std::cerr << "ERROR::BENCH::WRITE_FAILED " << path << std::endl;
+      continue;
+    }
+    r_runner.measure(entry.name, 8, [&]
+    {
+      MeshData mesh = MeshLoader::load(path);
+      if (mesh.indices.empty()) std::cerr << "ERROR::BENCH::LOAD_FAILED " << path << std::endl;
+    });
+  }
+  std::filesystem::remove_all(directory);
+}
+
+// Grid of p_count unit bricks, the shape of a level scaled up.
+static void make_bricks(uint32_t p_count, std::vector<glm::vec3>& r_mins, std::vector<glm::vec3>& r_maxs)
+{
+  uint32_t columns = (uint32_t)std::ceil(std::sqrt((float)p_count));
+  r_mins.resize(p_count);
+  r_maxs.resize(p_count);
+  for (uint32_t i = 0; i < p_count; ++i)
+  {
+    glm::vec3 center { (float)(i % columns) * 1.1f, (float)(i / columns) * 0.6f, 0.0f };
+    r_mins[i] = center - glm::vec3 { 0.5f, 0.25f, 0.25f };
+    r_maxs[i] = center + glm::vec3 { 0.5f, 0.25f, 0.25f };
+  }
+}
+
+static void bench_simulation(BenchRunner& r_runner, JobSystem& p_jobs)
+{
+  if (!r_runner.enabled("simulation_tick")) return;
+
+  // Roughly a busy frame: debris, an attached-object hierarchy and culling
+  // a full level.
+  ParticleSystem particles;
+  ParticleBurst burst;
+  burst.count = 32768;
+  burst.lifetime = 1e6f;
+  particles.spawn(burst);
+  std::vector<ParticleInstance> instances(ParticleSystem::MAX_PARTICLES);
+
+  TransformHierarchy transforms;
+  std::vector<uint32_t> roots;
+  for (int i = 0; i < 64; ++i)
+  {
+    uint32_t root = transforms.create();
+    roots.push_back(root);
+    for (int j = 0; j < 63; ++j) transforms.create(root);
+  }
+
+  std::vector<glm::vec3> mins;
+  std::vector<glm::vec3> maxs;
+  make_bricks(Level::MAX_BRICKS, mins, maxs);
+  BVH bvh;
+  bvh.build(p_jobs, mins.data(), maxs.data(), mins.size());
+  std::vector<uint32_t> visible(mins.size());
+  glm::mat4 view = glm::translate(glm::mat4 { 1.0f }, glm::vec3 { -20.0f, -10.0f, -30.0f });
+  Frustum frustum = Frustum::from_matrix(glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f) * view);
+
+  float time = 0.0f;
+  r_runner.measure("simulation_tick", 200, [&]
+  {
+    time += 1.0f / 60.0f;
+    for (size_t i = 0; i < roots.size(); ++i) transforms.set_position(roots[i], glm::vec3 { std::sin(time + i), 0.0f, 0.0f });
+    transforms.update();
+    particles.update(p_jobs, 1.0f / 60.0f);
+    particles.write_instances(instances.data());
+    bvh.cull(frustum, visible.data(), visible.size());
+  });
+}
+
+static void bench_collision(BenchRunner& r_runner, JobSystem& p_jobs)
+{
+  const uint32_t ball_counts[] = { 16, 256 };
+  const uint32_t brick_counts[] = { 256, 2048 };
+  for (uint32_t brick_count : brick_counts)
+  {
+    std::vector<glm::vec3> mins;
+    std::vector<glm::vec3> maxs;
+    make_bricks(brick_count, mins, maxs);
+    BVH bvh;
+    bvh.build(p_jobs, mins.data(), maxs.data(), brick_count);
+    glm::vec3 extent = maxs.back();
+
+    for (uint32_t ball_count : ball_counts)
+    {
+      // Balls below the wall moving up at spread angles, most of them hit.
+      std::vector<glm::vec3> origins(ball_count);
+      std::vector<glm::vec3> directions(ball_count);
+      for (uint32_t i = 0; i < ball_count; ++i)
+      {
+        float t = (i + 0.5f) / ball_count;
+        origins[i] = glm::vec3 { t * extent.x, -2.0f, 0.0f };
+        directions[i] = glm::normalize(glm::vec3 { (t - 0.5f) * 0.5f, 1.0f, 0.0f });
+      }
+
+      std::string name = "collision_" + std::to_string(ball_count) + "x" + std::to_string(brick_count);
+      uint32_t hits = 0;
+      r_runner.measure(name, 100, [&]
+      {
+        BVHHit hit;
+        for (uint32_t i = 0; i < ball_count; ++i) hits += bvh.sweep_sphere(origins[i], 0.1f, directions[i], 100.0f, &hit);
+      });
+      if (r_runner.enabled(name) && hits == 0) std::cerr << "WARNING::BENCH::NO_HITS " << name << std::endl;
+    }
+
+    r_runner.measure("bvh_build_" + std::to_string(brick_count), 50, [&] { bvh.build(p_jobs, mins.data(), maxs.data(), brick_count); });
+  }
+}
+
+static void empty_job(void*)
+{
+}
+
+static void bench_job_system(BenchRunner& r_runner, JobSystem& p_jobs)
+{
+  std::vector<float> values(1 << 20, 1.0f);
+  r_runner.measure("job_parallel_for_1m", 100, [&]
+  {
+    p_jobs.parallel_for(values.size(), 4096, [&](size_t p_begin, size_t p_end)
+    {
+      for (size_t i = p_begin; i < p_end; ++i) values[i] = std::sqrt(values[i] * 1.0001f + 0.5f);
+    });
+  });
+
+  // Scheduling cost alone.
+  std::vector<Job> jobs(1024);
+  for (Job& job : jobs) job.function = empty_job;
+  r_runner.measure("job_overhead_1024", 200, [&]
+  {
+    JobCounter counter;
+    p_jobs.run(jobs.data(), jobs.size(), &counter);
+    p_jobs.wait(&counter);
+  });
+}
+
+static void bench_shader_compile(BenchRunner& r_runner)
+{
+  // Drivers with a shader cache only compile the first time, so this is
+  // mostly file IO plus a cache lookup there.
+  r_runner.measure("shader_compile_default", 10, []
+  {
+    unsigned int program = Shader::load_program("../res/shaders/default.vert", "../res/shaders/default.frag");
+    glDeleteProgram(program);
+  });
+}
+
+// K pyramids through the same render queue, UBO and state cache path as the
+// game, into an offscreen target. glFinish() makes each sample a full frame.
+static void bench_render(BenchRunner& r_runner)
+{
+  const uint32_t instance_counts[] = { 256, UniformBuffers::MAX_OBJECTS };
+  bool any = false;
+  for (uint32_t count : instance_counts) any |= r_runner.enabled("render_instances_" + std::to_string(count));
+  if (!any) return;
+
+  const int width = 640;
+  const int height = 480;
+  GLuint framebuffer = 0;
+  GLuint renderbuffers[2] {};
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glGenRenderbuffers(2, renderbuffers);
+  glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+  glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+  glViewport(0, 0, width, height);
+
+  GLStateCache state;
+  GeometryPool geometry;
+  geometry.init(state, 1 << 16, 1 << 16);
+  MeshData mesh = MeshLoader::load("../res/models/pyramid/pyramid.gltf");
+  GeometryRange range = geometry.add(state, mesh.positions.data(), mesh.tex_coords.data(), (uint32_t)(mesh.positions.size() / 3), mesh.indices.data(), (uint32_t)mesh.indices.size());
+
+  unsigned int program = Shader::load_program("../res/shaders/default.vert", "../res/shaders/default.frag");
+  UniformBuffers::bind_program_blocks(program);
+  UniformBuffers uniforms;
+  uniforms.init(state);
+
+  RenderResources resources;
+  resources.programs.push_back({ program });
+  resources.materials.push_back({ 0 });
+  resources.meshes.push_back({ geometry.get_vao(), range });
+
+  FrameUniforms frame_uniforms;
+  frame_uniforms.view = glm::translate(glm::mat4 { 1.0f }, glm::vec3 { 0.0f, 0.0f, -40.0f });
+  frame_uniforms.projection = glm::perspective(glm::radians(45.0f), (float)width / height, 0.1f, 100.0f);
+  frame_uniforms.time = 0.0f;
+
+  FrameArena arena { 1 << 20 };
+  std::vector<RenderObject> objects(UniformBuffers::MAX_OBJECTS);
+  for (uint32_t count : instance_counts)
+  {
+    uint32_t columns = (uint32_t)std::ceil(std::sqrt((float)count));
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      glm::vec3 position { (float)(i % columns) - columns * 0.5f, (float)(i / columns) - columns * 0.5f, 0.0f };
+      objects[i].model = glm::scale(glm::translate(glm::mat4 { 1.0f }, position * (30.0f / columns)), glm::vec3 { 15.0f / columns });
+    }
+
+    r_runner.measure("render_instances_" + std::to_string(count), 50, [&]
+    {
+      arena.reset();
+      state.begin_frame();
+      state.enable(GL_DEPTH_TEST);
+      state.clear_color(0.0f, 0.0f, 0.0f, 1.0f);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+      uniforms.upload(state, frame_uniforms, objects.data(), count);
+      RenderQueue queue { arena };
+      for (uint32_t i = 0; i < count; ++i) queue.submit(RenderQueue::make_key(RenderQueue::LAYER_OPAQUE, 0, 0, 0, (float)i / count), i);
+      queue.sort();
+      RenderQueue::execute(state, uniforms, queue.get_packets(), queue.get_packet_count(), resources);
+
+      uniforms.end_frame();
+      glFinish();
+    });
+  }
+
+  geometry.destroy();
+  glDeleteProgram(program);
+  glDeleteRenderbuffers(2, renderbuffers);
+  glDeleteFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+int main(int argc, char* argv[])
+{
+  BenchRunner runner;
+  std::string out_path = "bench_results.json";
+  std::string baseline_path = "../bench/baseline.json";
+  bool update_baseline = false;
+  double default_threshold = 0.10;
+  double min_delta_ms = 0.02;
+  std::vector<Threshold> thresholds;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--filter" && has_value)
+      runner.filter = argv[++i];
+    else if (arg == "--out" && has_value)
+      out_path = argv[++i];
+    else if (arg == "--baseline" && has_value)
+      baseline_path = argv[++i];
+    else if (arg == "--update-baseline")
+      update_baseline = true;
+    else if (arg == "--min-delta-ms" && has_value)
+      min_delta_ms = std::atof(argv[++i]);
+    else if (arg == "--threshold" && has_value)
+    {
+      std::string value = argv[++i];
+      size_t equals = value.find('=');
+      if (equals == std::string::npos)
+        default_threshold = std::atof(value.c_str());
+      else
+        thresholds.push_back({ value.substr(0, equals), std::atof(value.c_str() + equals + 1) });
+    }
+    else
+    {
+      std::cerr << "ERROR::BENCH::UNKNOWN_ARGUMENT " << arg << std::endl;
+      return 2;
+    }
+  }
+
+  // Hidden window for the GL scenarios, everything else runs without one.
+  bool has_gl = false;
+  SDL_Window* window = nullptr;
+  SDL_GLContext opengl_context = nullptr;
+  std::string renderer = "none";
+  if (SDL_Init(SDL_INIT_VIDEO))
+  {
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    window = SDL_CreateWindow("bench_suite", 64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (window != nullptr) opengl_context = SDL_GL_CreateContext(window);
+    has_gl = opengl_context != nullptr && glewInit() == GLEW_OK;
+  }
+  if (has_gl)
+    renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+  else
+    std::cerr << "WARNING::BENCH::NO_GL_CONTEXT skipping GL scenarios " << SDL_GetError() << std::endl;
+
+  JobSystem jobs;
+  std::cout << "renderer: " << renderer << ", " << jobs.get_thread_count() << " threads" << std::endl;
+  printf("%-32s %10s %10s %10s %10s %8s\n", "scenario", "median ms", "p90 ms", "p99 ms", "stddev", "allocs");
+
+  bench_asset_loads(runner);
+  bench_simulation(runner, jobs);
+  bench_collision(runner, jobs);
+  bench_job_system(runner, jobs);
+  if (has_gl)
+  {
+    bench_shader_compile(runner);
+    bench_render(runner);
+  }
+
+  if (!write_results(out_path, renderer, jobs.get_thread_count(), runner.results))
+    std::cerr << "ERROR::BENCH::WRITE_FAILED " << out_path << std::endl;
+
+  int regressions = 0;
+  std::string baseline_renderer;
+  std::vector<BaselineEntry> baseline;
+  if (update_baseline)
+  {
+    if (write_results(baseline_path, renderer, jobs.get_thread_count(), runner.results))
+      std::cout << "BENCH::BASELINE_UPDATED " << baseline_path << std::endl;
+    else
+      std::cerr << "ERROR::BENCH::WRITE_FAILED " << baseline_path << std::endl;
+  }
+  else if (read_baseline(baseline_path, baseline_renderer, baseline))
+  {
+    if (baseline_renderer != renderer) std::cerr << "WARNING::BENCH::BASELINE_RENDERER " << baseline_renderer << " vs " << renderer << std::endl;
+    regressions = compare(runner.results, baseline, default_threshold, thresholds, min_delta_ms);
+    if (regressions > 0) std::cerr << "ERROR::BENCH::REGRESSIONS " << regressions << std::endl;
+  }
+
+  if (opengl_context != nullptr) SDL_GL_DestroyContext(opengl_context);
+  if (window != nullptr) SDL_DestroyWindow(window);
+  SDL_Quit();
+  return regressions > 0 ? 1 : 0;
+}
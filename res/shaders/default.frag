@@ -1,6 +1,7 @@
 #version 330 core
 
 in vec2 v_tex_coord;
+in vec4 v_color;
 
 uniform sampler2D u_texture;
 
@@ -8,5 +9,5 @@ out vec4 o_col;
 
 void main()
 {
-  o_col = texture(u_texture, v_tex_coord);
+  o_col = texture(u_texture, v_tex_coord) * v_color;
 }
@@ -4,13 +4,24 @@ layout (location = 0) in vec3 a_pos;
 layout (location = 1) in vec2 a_tex_coord;
 
 out vec2 v_tex_coord;
+out vec4 v_color;
 
-uniform mat4 u_model;
-uniform mat4 u_view;
-uniform mat4 u_projection;
+layout (std140) uniform FrameData
+{
+  mat4 u_view;
+  mat4 u_projection;
+  float u_time;
+};
+
+layout (std140) uniform ObjectData
+{
+  mat4 u_model;
+  vec4 u_color;
+};
 
 void main()
 {
   v_tex_coord = a_tex_coord;
+  v_color = u_color;
   gl_Position = u_projection * u_view * u_model * vec4(a_pos.x, a_pos.y, a_pos.z, 1.0);
 }
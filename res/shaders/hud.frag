@@ -0,0 +1,13 @@
+#version 330 core
+
+in vec2 v_tex_coord;
+in vec4 v_color;
+
+uniform sampler2D u_atlas;
+
+out vec4 o_col;
+
+void main()
+{
+  o_col = vec4(v_color.rgb, v_color.a * texture(u_atlas, v_tex_coord).r);
+}
@@ -0,0 +1,25 @@
+#version 330 core
+
+layout (location = 0) in vec4 a_rect;
+layout (location = 1) in uint a_glyph;
+layout (location = 2) in vec4 a_color;
+
+uniform vec2 u_screen_size;
+
+out vec2 v_tex_coord;
+out vec4 v_color;
+
+// Cells of the glyph atlas, ASCII 32 in the top left, see PerfHud.
+const vec2 ATLAS_CELLS = vec2(16.0, 6.0);
+
+void main()
+{
+  // Quad corner from the vertex id, drawn as a 4 vertex strip per instance.
+  vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+  vec2 pixel = a_rect.xy + corner * a_rect.zw;
+  gl_Position = vec4(pixel / u_screen_size * vec2(2.0, -2.0) + vec2(-1.0, 1.0), 0.0, 1.0);
+
+  uint cell = a_glyph - 32u;
+  v_tex_coord = (vec2(cell % 16u, cell / 16u) + corner) / ATLAS_CELLS;
+  v_color = a_color;
+}
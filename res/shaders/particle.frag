@@ -0,0 +1,13 @@
+#version 330 core
+
+in vec2 v_corner;
+in vec4 v_color;
+
+out vec4 o_col;
+
+void main()
+{
+  // Soft round sprite.
+  float falloff = clamp(1.0 - dot(v_corner, v_corner), 0.0, 1.0);
+  o_col = vec4(v_color.rgb, v_color.a * falloff);
+}
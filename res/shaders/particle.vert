@@ -0,0 +1,26 @@
+#version 330 core
+
+layout (location = 0) in vec4 a_position_size;
+layout (location = 1) in vec4 a_color;
+
+out vec2 v_corner;
+out vec4 v_color;
+
+layout (std140) uniform FrameData
+{
+  mat4 u_view;
+  mat4 u_projection;
+  float u_time;
+};
+
+void main()
+{
+  // Quad corner from the vertex id, drawn as a 4 vertex strip per instance.
+  v_corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+  v_color = a_color;
+
+  vec3 right = vec3(u_view[0][0], u_view[1][0], u_view[2][0]);
+  vec3 up = vec3(u_view[0][1], u_view[1][1], u_view[2][1]);
+  vec3 position = a_position_size.xyz + (right * v_corner.x + up * v_corner.y) * a_position_size.w;
+  gl_Position = u_projection * u_view * vec4(position, 1.0);
+}
@@ -0,0 +1,31 @@
+#version 330 core
+
+layout (location = 0) in vec4 a_position_size;
+layout (location = 1) in vec4 a_velocity_life;
+layout (location = 2) in vec4 a_color;
+layout (location = 3) in vec4 a_params;
+
+// Captured with transform feedback, same layout as the inputs.
+out vec4 o_position_size;
+out vec4 o_velocity_life;
+out vec4 o_color;
+out vec4 o_params;
+
+uniform float u_delta;
+uniform vec3 u_gravity;
+uniform float u_drag;
+
+void main()
+{
+  float life = a_velocity_life.w - u_delta;
+  vec3 velocity = (a_velocity_life.xyz + u_gravity * u_delta) * max(0.0, 1.0 - u_drag * u_delta);
+  vec3 position = a_position_size.xyz + velocity * u_delta;
+
+  // Dead particles keep their slot with zero size until it is respawned.
+  float size = life > 0.0 ? a_position_size.w : 0.0;
+
+  o_position_size = vec4(position, size);
+  o_velocity_life = vec4(velocity, life);
+  o_color = vec4(a_color.rgb, clamp(life * a_params.x, 0.0, 1.0));
+  o_params = a_params;
+}
@@ -0,0 +1,273 @@
+#include "./asset_pack.h"
+
+#include "./compression.h"
+#include "./job_system.h"
+#include "./utils.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+
+static std::atomic<const AssetPack*> mounted_pack { nullptr };
+
+AssetPack::~AssetPack()
+{
+  close();
+}
+
+bool AssetPack::open(const std::string& p_path)
+{
+  close();
+
+  int fd = ::open(p_path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(PackHeader))
+  {
+    ::close(fd);
+    std::cerr << "ERROR::ASSET_PACK::INVALID " << p_path << std::endl;
+    return false;
+  }
+
+  // The mapping stays valid after the descriptor is closed.
+  void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    std::cerr << "ERROR::ASSET_PACK::MMAP_FAILED " << p_path << std::endl;
+    return false;
+  }
+
+  data = static_cast<const unsigned char*>(mapping);
+  size = info.st_size;
+
+  const PackHeader* header = reinterpret_cast<const PackHeader*>(data);
+  if (header->magic != MAGIC || header->version != VERSION || sizeof(PackHeader) + header->entry_count * sizeof(PackEntry) > size)
+  {
+    std::cerr << "ERROR::ASSET_PACK::INVALID " << p_path << std::endl;
+    close();
+    return false;
+  }
+
+  entries = reinterpret_cast<const PackEntry*>(data + sizeof(PackHeader));
+  entry_count = header->entry_count;
+  return true;
+}
+
+void AssetPack::close()
+{
+  if (data != nullptr) munmap(const_cast<unsigned char*>(data), size);
+  data = nullptr;
+  size = 0;
+  entries = nullptr;
+  entry_count = 0;
+}
+
+std::string AssetPack::normalize_path(const std::string& p_path)
+{
+  std::string path = p_path;
+  std::replace(path.begin(), path.end(), '\\', '/');
+
+  // Collapse "dir/../" and drop "./", leading "../" only says where res/ is
+  // relative to the working directory.
+  std::vector<std::string> parts;
+  size_t start = 0;
+  while (start <= path.size())
+  {
+    size_t end = path.find('/', start);
+    if (end == std::string::npos) end = path.size();
+    std::string part = path.substr(start, end - start);
+    start = end + 1;
+
+    if (part.empty() || part == ".") continue;
+    if (part == "..")
+    {
+      if (!parts.empty()) parts.pop_back();
+      continue;
+    }
+    parts.push_back(part);
+  }
+
+  std::string normalized;
+  for (const std::string& part : parts)
+  {
+    if (!normalized.empty()) normalized += '/';
+    normalized += part;
+  }
+  return normalized;
+}
+
+uint64_t AssetPack::hash_path(const std::string& p_path)
+{
+  return Utils::hash_string(normalize_path(p_path));
+}
+
+const AssetPack::PackEntry* AssetPack::find(uint64_t p_hash) const
+{
+  const PackEntry* end = entries + entry_count;
+  const PackEntry* it = std::lower_bound(entries, end, p_hash, [](const PackEntry& p_entry, uint64_t p_value) { return p_entry.hash < p_value; });
+  return it != end && it->hash == p_hash ? it : nullptr;
+}
+
+bool AssetPack::read(const std::string& p_path, std::vector<unsigned char>& r_data) const
+{
+  const PackEntry* entry = find(p_path);
+  if (entry == nullptr) return false;
+
+  r_data.resize(entry->size);
+  if (!read_into(*entry, r_data.data(), r_data.size()))
+  {
+    std::cerr << "ERROR::ASSET_PACK::CORRUPT_ENTRY " << p_path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool AssetPack::read_into(const PackEntry& p_entry, unsigned char* r_dst, size_t p_capacity) const
+{
+  if (p_capacity < p_entry.size) return false;
+  return read_into(p_entry, 0, p_entry.size, r_dst);
+}
+
+bool AssetPack::read_into(const PackEntry& p_entry, size_t p_offset, size_t p_size, unsigned char* r_dst) const
+{
+  if (p_entry.offset + p_entry.stored_size > size || p_offset > p_entry.size || p_size > p_entry.size - p_offset) return false;
+  if (p_size == 0) return true;
+
+  const unsigned char* stored = get_stored(p_entry);
+  if (p_entry.flags & ENTRY_BLOCKED)
+  {
+    if (p_entry.stored_size < sizeof(BlockHeader)) return false;
+    BlockHeader header;
+    std::memcpy(&header, stored, sizeof(header));
+    if (header.block_size == 0) return false;
+    // Exactly as many blocks as the size needs, otherwise the last block's
+    // length below underflows and decoding writes past r_dst.
+    if (header.block_count != ((uint64_t)p_entry.size + header.block_size - 1) / header.block_size) return false;
+
+    const uint32_t* block_sizes = reinterpret_cast<const uint32_t*>(stored + sizeof(BlockHeader));
+    size_t table_size = sizeof(BlockHeader) + header.block_count * sizeof(uint32_t);
+    if (table_size > p_entry.stored_size) return false;
+
+    // Where each block starts, so they can be decoded independently. The
+    // table is small, one entry per 64 KiB.
+    std::vector<size_t> offsets(header.block_count + 1);
+    offsets[0] = table_size;
+    for (uint32_t i = 0; i < header.block_count; ++i) offsets[i + 1] = offsets[i] + (block_sizes[i] & ~BLOCK_RAW);
+    if (offsets[header.block_count] > p_entry.stored_size) return false;
+
+    auto decode_block = [&](size_t p_index, unsigned char* r_block, size_t p_block_size)
+    {
+      const unsigned char* src = stored + offsets[p_index];
+      size_t src_size = offsets[p_index + 1] - offsets[p_index];
+      if (!(block_sizes[p_index] & BLOCK_RAW)) return Compression::decompress(src, src_size, r_block, p_block_size);
+      if (src_size != p_block_size) return false;
+      std::memcpy(r_block, src, p_block_size);
+      return true;
+    };
+
+    // Blocks the range covers completely go straight to r_dst, the partial
+    // ones at its ends through a scratch block.
+    size_t first = p_offset / header.block_size;
+    size_t last = (p_offset + p_size - 1) / header.block_size;
+    std::atomic<bool> failed { false };
+    auto decode = [&](size_t p_begin, size_t p_end)
+    {
+      for (size_t i = first + p_begin; i < first + p_end; ++i)
+      {
+        size_t block_offset = i * header.block_size;
+        size_t block_size = std::min<size_t>(header.block_size, p_entry.size - block_offset);
+        size_t begin = std::max(block_offset, p_offset);
+        size_t end = std::min(block_offset + block_size, p_offset + p_size);
+
+        bool ok;
+        if (begin == block_offset && end == block_offset + block_size)
+        {
+          ok = decode_block(i, r_dst + (begin - p_offset), block_size);
+        }
+        else
+        {
+          std::vector<unsigned char> block(block_size);
+          ok = decode_block(i, block.data(), block_size);
+          if (ok) std::memcpy(r_dst + (begin - p_offset), block.data() + (begin - block_offset), end - begin);
+        }
+        if (!ok) failed.store(true, std::memory_order_relaxed);
+      }
+    };
+
+    if (jobs != nullptr)
+      jobs->parallel_for(last - first + 1, 1, decode);
+    else
+      decode(0, last - first + 1);
+    return !failed.load(std::memory_order_relaxed);
+  }
+
+  if (p_entry.flags & ENTRY_COMPRESSED)
+  {
+    if (p_offset == 0 && p_size == p_entry.size) return Compression::decompress(stored, p_entry.stored_size, r_dst, p_size);
+
+    // Single stream, a part of it needs the whole.
+    std::vector<unsigned char> content(p_entry.size);
+    if (!Compression::decompress(stored, p_entry.stored_size, content.data(), content.size())) return false;
+    std::memcpy(r_dst, content.data() + p_offset, p_size);
+    return true;
+  }
+
+  std::memcpy(r_dst, stored + p_offset, p_size);
+  return true;
+}
+
+std::vector<unsigned char> AssetPack::compress_blocked(const unsigned char* p_data, size_t p_size)
+{
+  BlockHeader header;
+  header.block_size = BLOCK_SIZE;
+  header.block_count = (uint32_t)((p_size + BLOCK_SIZE - 1) / BLOCK_SIZE);
+
+  size_t table_size = sizeof(BlockHeader) + header.block_count * sizeof(uint32_t);
+  std::vector<unsigned char> stored(table_size);
+  std::memcpy(stored.data(), &header, sizeof(header));
+
+  std::vector<unsigned char> block(Compression::get_bound(BLOCK_SIZE));
+  size_t compressed_blocks = 0;
+  for (uint32_t i = 0; i < header.block_count; ++i)
+  {
+    const unsigned char* src = p_data + (size_t)i * BLOCK_SIZE;
+    size_t src_size = std::min<size_t>(BLOCK_SIZE, p_size - (size_t)i * BLOCK_SIZE);
+    size_t block_size = Compression::compress(src, src_size, block.data(), block.size());
+
+    // Blocks that don't shrink are stored as they are.
+    uint32_t entry;
+    if (block_size == 0 || block_size >= src_size)
+    {
+      entry = (uint32_t)src_size | BLOCK_RAW;
+      stored.insert(stored.end(), src, src + src_size);
+    }
+    else
+    {
+      entry = (uint32_t)block_size;
+      stored.insert(stored.end(), block.data(), block.data() + block_size);
+      compressed_blocks++;
+    }
+    std::memcpy(stored.data() + sizeof(BlockHeader) + i * sizeof(uint32_t), &entry, sizeof(entry));
+  }
+
+  if (compressed_blocks == 0) return {};
+  return stored;
+}
+
+void AssetPack::mount(const AssetPack* p_pack)
+{
+  mounted_pack.store(p_pack, std::memory_order_release);
+}
+
+const AssetPack* AssetPack::get_mounted()
+{
+  return mounted_pack.load(std::memory_order_acquire);
+}
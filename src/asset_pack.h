@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+// Read-only archive of assets in one file, mapped into memory once. The
+// index right after the header is sorted by path hash, so a lookup is a
+// binary search and never touches the file system. Entry data is aligned and
+// optionally compressed (see Compression). Large entries are compressed in
+// independent blocks, which are decompressed in parallel when a JobSystem is
+// set. Paths are normalized before hashing, "../res/x" and "res/x" name the
+// same entry.
+//
+// Layout: PackHeader, PackEntry[entry_count], then the entry data. A blocked
+// entry starts with a BlockHeader and one uint32 stored size per block (top
+// bit set if the block is stored raw), followed by the blocks.
+class AssetPack
+{
+  public:
+  static constexpr uint32_t MAGIC = 0x4B415042; // "BPAK"
+  static constexpr uint32_t VERSION = 1;
+  static constexpr size_t ALIGNMENT = 16;
+  // Uncompressed bytes per block, below the codec's 64 KiB match window.
+  static constexpr uint32_t BLOCK_SIZE = 64 << 10;
+  static constexpr uint32_t BLOCK_RAW = 1u << 31;
+
+  enum EntryFlags
+  {
+    ENTRY_COMPRESSED = 1 << 0,
+    ENTRY_BLOCKED = 1 << 1,
+  };
+
+  struct BlockHeader
+  {
+    uint32_t block_size;
+    uint32_t block_count;
+  };
+
+  struct PackHeader
+  {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t pad;
+  };
+
+  struct PackEntry
+  {
+    uint64_t hash;
+    uint64_t offset;
+    uint32_t stored_size;
+    uint32_t size;
+    uint32_t flags;
+    uint32_t pad;
+  };
+
+  AssetPack() = default;
+  ~AssetPack();
+
+  AssetPack(const AssetPack&) = delete;
+  AssetPack& operator=(const AssetPack&) = delete;
+
+  bool open(const std::string& p_path);
+  void close();
+  bool is_open() const { return data != nullptr; }
+
+  static std::string normalize_path(const std::string& p_path);
+  static uint64_t hash_path(const std::string& p_path);
+
+  const PackEntry* find(uint64_t p_hash) const;
+  const PackEntry* find(const std::string& p_path) const { return find(hash_path(p_path)); }
+
+  // Decompresses if needed. False if the entry is missing or corrupt.
+  bool read(const std::string& p_path, std::vector<unsigned char>& r_data) const;
+
+  // Same, straight into caller memory (e.g. a mapped GL buffer) of at least
+  // the entry's size, without an intermediate copy.
+  bool read_into(const PackEntry& p_entry, unsigned char* r_dst, size_t p_capacity) const;
+
+  // p_size bytes from p_offset of the entry. Blocked entries only decode the
+  // blocks the range touches.
+  bool read_into(const PackEntry& p_entry, size_t p_offset, size_t p_size, unsigned char* r_dst) const;
+
+  // Blocks are handed out to the job system's workers, null decompresses on
+  // the calling thread.
+  void set_job_system(JobSystem* p_jobs) { jobs = p_jobs; }
+
+  // Stored form of a blocked entry, for the packer. Empty if it doesn't
+  // compress.
+  static std::vector<unsigned char> compress_blocked(const unsigned char* p_data, size_t p_size);
+
+  // Stored bytes of an entry, straight from the mapping. Only meaningful
+  // as-is for uncompressed entries.
+  const unsigned char* get_stored(const PackEntry& p_entry) const { return data + p_entry.offset; }
+
+  uint32_t get_entry_count() const { return entry_count; }
+
+  // Pack consulted by Utils::read_file() before loose files. Not owned.
+  static void mount(const AssetPack* p_pack);
+  static const AssetPack* get_mounted();
+
+  private:
+  const unsigned char* data = nullptr;
+  size_t size = 0;
+  const PackEntry* entries = nullptr;
+  uint32_t entry_count = 0;
+  JobSystem* jobs = nullptr;
+};
@@ -0,0 +1,213 @@
+#include "./base64.h"
+
+// NEON is part of every ARMv8 target. On x86 the build doesn't assume more
+// than SSE2, so the SSSE3 and AVX2 paths are compiled for their instruction
+// sets with target attributes and picked at runtime.
+#if defined(__ARM_NEON)
+  #include <arm_neon.h>
+  #define BASE64_NEON
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+  #include <immintrin.h>
+  #define BASE64_X86
+#endif
+
+#include <cstdint>
+
+// 0xFF marks characters outside the alphabet.
+static const uint8_t* get_decode_table()
+{
+  static const struct Table
+  {
+    uint8_t values[256];
+
+    Table()
+    {
+      const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+      for (int i = 0; i < 256; ++i) values[i] = 0xFF;
+      for (int i = 0; i < 64; ++i) values[(uint8_t)alphabet[i]] = (uint8_t)i;
+    }
+  } table;
+  return table.values;
+}
+
+// The vector paths classify characters by their nibbles (Muła and Lemire):
+// a lookup on each nibble gives bit sets whose AND is non-zero exactly for
+// characters outside the alphabet, and a lookup on the high nibble gives the
+// offset from ASCII to the 6 bit value. '/' shares its high nibble with '+'
+// and is moved to its own slot. Each returns the characters it consumed,
+// full blocks only, and stops early at an invalid one so the scalar loop
+// reports it.
+#if defined(BASE64_X86)
+static const int8_t NIBBLE_LO[16] = { 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A };
+static const int8_t NIBBLE_HI[16] = { 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 };
+static const int8_t ROLL[16] = { 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0 };
+// Bytes 2, 1, 0 of each 32 bit lane hold the 24 decoded bits.
+static const int8_t PACK[16] = { 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 };
+
+// 32 characters to 24 bytes. Stores 32, so needs 8 bytes of slack in r_dst.
+__attribute__((target("avx2"))) static size_t decode_avx2(const uint8_t* p_src, size_t p_size, unsigned char* r_dst, size_t p_capacity)
+{
+  const __m256i lut_lo = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(NIBBLE_LO)));
+  const __m256i lut_hi = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(NIBBLE_HI)));
+  const __m256i lut_roll = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ROLL)));
+  const __m256i pack = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(PACK)));
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  const __m256i slash = _mm256_set1_epi8('/');
+
+  size_t i = 0;
+  size_t o = 0;
+  for (; i + 32 <= p_size && o + 32 <= p_capacity; i += 32, o += 24)
+  {
+    __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p_src + i));
+    __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4), nibble);
+    __m256i lo = _mm256_shuffle_epi8(lut_lo, _mm256_and_si256(in, nibble));
+    __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    if (!_mm256_testz_si256(lo, hi)) break;
+
+    __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(_mm256_cmpeq_epi8(in, slash), hi_nibbles));
+    __m256i values = _mm256_add_epi8(in, roll);
+
+    // 4 x 6 bits to 24 bits per 32 bit lane.
+    __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    __m256i words = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+    __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(words, pack), lanes);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(r_dst + o), bytes);
+  }
+  return i;
+}
+
+// 16 characters to 12 bytes. Stores 16, so needs 4 bytes of slack in r_dst.
+__attribute__((target("ssse3"))) static size_t decode_ssse3(const uint8_t* p_src, size_t p_size, unsigned char* r_dst, size_t p_capacity)
+{
+  const __m128i lut_lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(NIBBLE_LO));
+  const __m128i lut_hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(NIBBLE_HI));
+  const __m128i lut_roll = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ROLL));
+  const __m128i pack = _mm_loadu_si128(reinterpret_cast<const __m128i*>(PACK));
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  const __m128i slash = _mm_set1_epi8('/');
+
+  size_t i = 0;
+  size_t o = 0;
+  for (; i + 16 <= p_size && o + 16 <= p_capacity; i += 16, o += 12)
+  {
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_src + i));
+    __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(in, 4), nibble);
+    __m128i lo = _mm_shuffle_epi8(lut_lo, _mm_and_si128(in, nibble));
+    __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0xFFFF) break;
+
+    __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(_mm_cmpeq_epi8(in, slash), hi_nibbles));
+    __m128i values = _mm_add_epi8(in, roll);
+
+    __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    __m128i words = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(r_dst + o), _mm_shuffle_epi8(words, pack));
+  }
+  return i;
+}
+
+static size_t decode_none(const uint8_t*, size_t, unsigned char*, size_t)
+{
+  return 0;
+}
+
+static size_t decode_simd(const uint8_t* p_src, size_t p_size, unsigned char* r_dst, size_t p_capacity)
+{
+  using DecodeFunc = size_t (*)(const uint8_t*, size_t, unsigned char*, size_t);
+  static const DecodeFunc decode = []
+  {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return &decode_avx2;
+    if (__builtin_cpu_supports("ssse3")) return &decode_ssse3;
+    return &decode_none;
+  }();
+  return decode(p_src, p_size, r_dst, p_capacity);
+}
+#elif defined(BASE64_NEON)
+static const uint8_t NIBBLE_LO[16] = { 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A };
+static const uint8_t NIBBLE_HI[16] = { 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 };
+static const uint8_t ROLL[16] = { 0, 16, 19, 4, 191, 191, 185, 185, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+// 6 bit values of 16 characters, false if any is outside the alphabet.
+static inline bool translate(uint8x16_t p_in, uint8x16_t& r_values)
+{
+  uint8x16_t hi_nibbles = vshrq_n_u8(p_in, 4);
+  uint8x16_t lo = vqtbl1q_u8(vld1q_u8(NIBBLE_LO), vandq_u8(p_in, vdupq_n_u8(0x0F)));
+  uint8x16_t hi = vqtbl1q_u8(vld1q_u8(NIBBLE_HI), hi_nibbles);
+  if (vmaxvq_u8(vandq_u8(lo, hi)) != 0) return false;
+
+  uint8x16_t roll = vqtbl1q_u8(vld1q_u8(ROLL), vaddq_u8(vceqq_u8(p_in, vdupq_n_u8('/')), hi_nibbles));
+  r_values = vaddq_u8(p_in, roll);
+  return true;
+}
+
+// 64 characters to 48 bytes, deinterleaved by the load and interleaved back
+// by the store, so no slack is needed.
+static size_t decode_simd(const uint8_t* p_src, size_t p_size, unsigned char* r_dst, size_t p_capacity)
+{
+  size_t i = 0;
+  size_t o = 0;
+  for (; i + 64 <= p_size && o + 48 <= p_capacity; i += 64, o += 48)
+  {
+    uint8x16x4_t in = vld4q_u8(p_src + i);
+    uint8x16_t a, b, c, d;
+    if (!translate(in.val[0], a) || !translate(in.val[1], b) || !translate(in.val[2], c) || !translate(in.val[3], d)) break;
+
+    uint8x16x3_t out;
+    out.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+    out.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+    out.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+    vst3q_u8(r_dst + o, out);
+  }
+  return i;
+}
+#else
+static size_t decode_simd(const uint8_t*, size_t, unsigned char*, size_t)
+{
+  return 0;
+}
+#endif
+
+size_t Base64::decode(const char* p_src, size_t p_size, unsigned char* r_dst, size_t p_capacity)
+{
+  if (p_size >= 1 && p_src[p_size - 1] == '=') p_size--;
+  if (p_size >= 1 && p_src[p_size - 1] == '=') p_size--;
+  if (p_size % 4 == 1) return 0;
+
+  size_t size = get_decoded_size(p_size);
+  if (size > p_capacity) return 0;
+
+  const uint8_t* table = get_decode_table();
+  const uint8_t* src = reinterpret_cast<const uint8_t*>(p_src);
+  unsigned char* dst = r_dst;
+
+  // Vector blocks first, the scalar loop finishes the tail.
+  size_t i = decode_simd(src, p_size, dst, p_capacity);
+  dst += i / 4 * 3;
+  for (; i + 4 <= p_size; i += 4)
+  {
+    uint32_t a = table[src[i]], b = table[src[i + 1]], c = table[src[i + 2]], d = table[src[i + 3]];
+    if ((a | b | c | d) & 0x80) return 0;
+    uint32_t bits = a << 18 | b << 12 | c << 6 | d;
+    *dst++ = (unsigned char)(bits >> 16);
+    *dst++ = (unsigned char)(bits >> 8);
+    *dst++ = (unsigned char)bits;
+  }
+
+  // 2 or 3 characters left, 1 or 2 bytes.
+  if (i < p_size)
+  {
+    uint32_t bits = 0;
+    for (size_t j = i; j < p_size; ++j)
+    {
+      uint32_t value = table[src[j]];
+      if (value & 0x80) return 0;
+      bits |= value << (18 - 6 * (j - i));
+    }
+    *dst++ = (unsigned char)(bits >> 16);
+    if (p_size - i == 3) *dst++ = (unsigned char)(bits >> 8);
+  }
+
+  return size;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+// Standard base64 (RFC 4648) as used by glTF data URIs. Decodes 64 characters
+// per step with NEON, or 32 or 16 with AVX2 or SSSE3 picked by what the CPU
+// supports, and falls back to a table lookup per character.
+class Base64
+{
+  public:
+  // Upper bound of the decoded size, exact for input without padding.
+  static size_t get_decoded_size(size_t p_size) { return p_size / 4 * 3 + (p_size % 4) * 3 / 4; }
+
+  // Returns the decoded size, or 0 on invalid input or if it didn't fit into
+  // p_capacity. Trailing '=' padding is optional, whitespace is not allowed.
+  static size_t decode(const char* p_src, size_t p_size, unsigned char* r_dst, size_t p_capacity);
+};
@@ -0,0 +1,367 @@
+#include "./bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+struct BVH::BuildContext
+{
+  JobSystem* jobs;
+  std::atomic<uint32_t> next_node { 0 };
+};
+
+// Subtrees above this size are handed to other workers.
+static constexpr uint32_t PARALLEL_THRESHOLD = 2048;
+
+static float surface_area(const glm::vec3& p_min, const glm::vec3& p_max)
+{
+  glm::vec3 size = p_max - p_min;
+  return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+void BVH::clear()
+{
+  nodes.clear();
+  items.clear();
+  item_mins.clear();
+  item_maxs.clear();
+  item_centroids.clear();
+  node_count = 0;
+}
+
+void BVH::build(JobSystem& p_jobs, const glm::vec3* p_mins, const glm::vec3* p_maxs, size_t p_count)
+{
+  clear();
+  if (p_count == 0) return;
+
+  items.resize(p_count);
+  item_mins.assign(p_mins, p_mins + p_count);
+  item_maxs.assign(p_maxs, p_maxs + p_count);
+  item_centroids.resize(p_count);
+  nodes.resize(p_count * 2);
+
+  BuildContext context;
+  context.jobs = &p_jobs;
+  for (size_t i = 0; i < p_count; ++i)
+  {
+    items[i] = (uint32_t)i;
+    item_centroids[i] = (p_mins[i] + p_maxs[i]) * 0.5f;
+  }
+
+  // Node 1 is left unused so sibling pairs start on an even index and share
+  // a cache line.
+  context.next_node = 2;
+  build_node(context, 0, 0, (uint32_t)p_count, 0);
+
+  node_count = context.next_node.load();
+  nodes.resize(node_count);
+}
+
+void BVH::build_node(BuildContext& p_context, uint32_t p_node, uint32_t p_first, uint32_t p_count, int p_depth)
+{
+  BVHNode& node = nodes[p_node];
+
+  glm::vec3 bounds_min { FLT_MAX };
+  glm::vec3 bounds_max { -FLT_MAX };
+  glm::vec3 centroid_min { FLT_MAX };
+  glm::vec3 centroid_max { -FLT_MAX };
+  for (uint32_t i = p_first; i < p_first + p_count; ++i)
+  {
+    uint32_t item = items[i];
+    bounds_min = glm::min(bounds_min, item_mins[item]);
+    bounds_max = glm::max(bounds_max, item_maxs[item]);
+    centroid_min = glm::min(centroid_min, item_centroids[item]);
+    centroid_max = glm::max(centroid_max, item_centroids[item]);
+  }
+  node.bounds_min = bounds_min;
+  node.bounds_max = bounds_max;
+
+  auto make_leaf = [&]()
+  {
+    node.first = p_first;
+    node.count = p_count;
+  };
+
+  if (p_count <= MAX_LEAF_ITEMS || p_depth >= MAX_DEPTH - 1)
+  {
+    make_leaf();
+    return;
+  }
+
+  // Binned SAH over all three axes.
+  struct Bin
+  {
+    glm::vec3 bounds_min { FLT_MAX };
+    glm::vec3 bounds_max { -FLT_MAX };
+    uint32_t count = 0;
+  };
+
+  float best_cost = FLT_MAX;
+  int best_axis = -1;
+  int best_split = 0;
+
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    float extent = centroid_max[axis] - centroid_min[axis];
+    if (extent <= 0.0f) continue;
+
+    Bin bins[SAH_BINS];
+    float scale = SAH_BINS / extent;
+    for (uint32_t i = p_first; i < p_first + p_count; ++i)
+    {
+      uint32_t item = items[i];
+      int bin = std::min(SAH_BINS - 1, (int)((item_centroids[item][axis] - centroid_min[axis]) * scale));
+      bins[bin].count++;
+      bins[bin].bounds_min = glm::min(bins[bin].bounds_min, item_mins[item]);
+      bins[bin].bounds_max = glm::max(bins[bin].bounds_max, item_maxs[item]);
+    }
+
+    // Sweep from both sides to get the cost of every split plane.
+    float left_area[SAH_BINS - 1];
+    uint32_t left_count[SAH_BINS - 1];
+    glm::vec3 sweep_min { FLT_MAX };
+    glm::vec3 sweep_max { -FLT_MAX };
+    uint32_t sweep_count = 0;
+    for (int i = 0; i < SAH_BINS - 1; ++i)
+    {
+      sweep_count += bins[i].count;
+      sweep_min = glm::min(sweep_min, bins[i].bounds_min);
+      sweep_max = glm::max(sweep_max, bins[i].bounds_max);
+      left_count[i] = sweep_count;
+      left_area[i] = sweep_count ? surface_area(sweep_min, sweep_max) : 0.0f;
+    }
+
+    sweep_min = glm::vec3 { FLT_MAX };
+    sweep_max = glm::vec3 { -FLT_MAX };
+    sweep_count = 0;
+    for (int i = SAH_BINS - 1; i > 0; --i)
+    {
+      sweep_count += bins[i].count;
+      sweep_min = glm::min(sweep_min, bins[i].bounds_min);
+      sweep_max = glm::max(sweep_max, bins[i].bounds_max);
+      float right_area = sweep_count ? surface_area(sweep_min, sweep_max) : 0.0f;
+
+      float cost = left_count[i - 1] * left_area[i - 1] + sweep_count * right_area;
+      if (left_count[i - 1] > 0 && sweep_count > 0 && cost < best_cost)
+      {
+        best_cost = cost;
+        best_axis = axis;
+        best_split = i;
+      }
+    }
+  }
+
+  // Splitting has to beat intersecting every item of a leaf.
+  float leaf_cost = p_count * surface_area(bounds_min, bounds_max);
+  if (best_axis < 0 || (best_cost >= leaf_cost && p_count <= 16 * MAX_LEAF_ITEMS))
+  {
+    make_leaf();
+    return;
+  }
+
+  float split_scale = SAH_BINS / (centroid_max[best_axis] - centroid_min[best_axis]);
+  uint32_t* begin = items.data() + p_first;
+  uint32_t* middle = std::partition(begin, begin + p_count, [&](uint32_t p_item)
+  {
+    int bin = std::min(SAH_BINS - 1, (int)((item_centroids[p_item][best_axis] - centroid_min[best_axis]) * split_scale));
+    return bin < best_split;
+  });
+
+  uint32_t left_count = (uint32_t)(middle - begin);
+  uint32_t left = p_context.next_node.fetch_add(2, std::memory_order_relaxed);
+  node.first = left;
+  node.count = 0;
+
+  if (p_count < PARALLEL_THRESHOLD)
+  {
+    build_node(p_context, left, p_first, left_count, p_depth + 1);
+    build_node(p_context, left + 1, p_first + left_count, p_count - left_count, p_depth + 1);
+    return;
+  }
+
+  struct ChildBuild
+  {
+    BVH* bvh;
+    BuildContext* context;
+    uint32_t node;
+    uint32_t first;
+    uint32_t count;
+    int depth;
+  };
+  ChildBuild children[2] = {
+    { this, &p_context, left, p_first, left_count, p_depth + 1 },
+    { this, &p_context, left + 1, p_first + left_count, p_count - left_count, p_depth + 1 },
+  };
+
+  Job jobs[2];
+  for (int i = 0; i < 2; ++i)
+  {
+    jobs[i].function = [](void* p_data)
+    {
+      ChildBuild* child = static_cast<ChildBuild*>(p_data);
+      child->bvh->build_node(*child->context, child->node, child->first, child->count, child->depth);
+    };
+    jobs[i].data = &children[i];
+  }
+
+  JobCounter counter;
+  p_context.jobs->run(jobs, 2, &counter);
+  p_context.jobs->wait(&counter);
+}
+
+static bool box_outside(const Frustum& p_frustum, const glm::vec3& p_min, const glm::vec3& p_max)
+{
+  glm::vec3 center = (p_min + p_max) * 0.5f;
+  glm::vec3 extent = (p_max - p_min) * 0.5f;
+  for (const glm::vec4& plane : p_frustum.planes)
+  {
+    float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+    float reach = std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y + std::fabs(plane.z) * extent.z;
+    if (distance <= -reach) return true;
+  }
+  return false;
+}
+
+size_t BVH::cull(const Frustum& p_frustum, uint32_t* r_items, size_t p_capacity) const
+{
+  if (node_count == 0) return 0;
+
+  size_t visible = 0;
+  uint32_t stack[MAX_DEPTH * 2];
+  int top = 0;
+  stack[top++] = 0;
+
+  while (top > 0)
+  {
+    const BVHNode& node = nodes[stack[--top]];
+    if (box_outside(p_frustum, node.bounds_min, node.bounds_max)) continue;
+
+    if (node.count == 0)
+    {
+      stack[top++] = node.first;
+      stack[top++] = node.first + 1;
+      continue;
+    }
+
+    for (uint32_t i = node.first; i < node.first + node.count; ++i)
+    {
+      uint32_t item = items[i];
+      if (box_outside(p_frustum, item_mins[item], item_maxs[item])) continue;
+      if (visible < p_capacity) r_items[visible] = item;
+      visible++;
+    }
+  }
+  return visible;
+}
+
+// Slab test, returns the entry distance or FLT_MAX on a miss.
+static float ray_box(const glm::vec3& p_origin, const glm::vec3& p_inv_direction, const glm::vec3& p_min, const glm::vec3& p_max, float p_max_distance)
+{
+  glm::vec3 t0 = (p_min - p_origin) * p_inv_direction;
+  glm::vec3 t1 = (p_max - p_origin) * p_inv_direction;
+  glm::vec3 t_near = glm::min(t0, t1);
+  glm::vec3 t_far = glm::max(t0, t1);
+  float enter = std::max(std::max(t_near.x, t_near.y), std::max(t_near.z, 0.0f));
+  float exit = std::min(std::min(t_far.x, t_far.y), std::min(t_far.z, p_max_distance));
+  return enter <= exit ? enter : FLT_MAX;
+}
+
+bool BVH::sweep_sphere(const glm::vec3& p_origin, float p_radius, const glm::vec3& p_direction, float p_max_distance, BVHHit* r_hit) const
+{
+  if (node_count == 0) return false;
+
+  glm::vec3 inv_direction = glm::vec3 { 1.0f } / p_direction;
+  glm::vec3 inflate { p_radius };
+  float closest = p_max_distance;
+  uint32_t closest_item = UINT32_MAX;
+
+  uint32_t stack[MAX_DEPTH * 2];
+  int top = 0;
+  stack[top++] = 0;
+
+  while (top > 0)
+  {
+    const BVHNode& node = nodes[stack[--top]];
+    if (ray_box(p_origin, inv_direction, node.bounds_min - inflate, node.bounds_max + inflate, closest) == FLT_MAX) continue;
+
+    if (node.count == 0)
+    {
+      // Visit the nearer child first so the far one is more likely culled.
+      const BVHNode& left = nodes[node.first];
+      const BVHNode& right = nodes[node.first + 1];
+      float left_distance = ray_box(p_origin, inv_direction, left.bounds_min - inflate, left.bounds_max + inflate, closest);
+      float right_distance = ray_box(p_origin, inv_direction, right.bounds_min - inflate, right.bounds_max + inflate, closest);
+      if (left_distance < right_distance)
+      {
+        if (right_distance != FLT_MAX) stack[top++] = node.first + 1;
+        stack[top++] = node.first;
+      }
+      else
+      {
+        if (left_distance != FLT_MAX) stack[top++] = node.first;
+        if (right_distance != FLT_MAX) stack[top++] = node.first + 1;
+      }
+      continue;
+    }
+
+    for (uint32_t i = node.first; i < node.first + node.count; ++i)
+    {
+      uint32_t item = items[i];
+      float distance = ray_box(p_origin, inv_direction, item_mins[item] - inflate, item_maxs[item] + inflate, closest);
+      if (distance < closest)
+      {
+        closest = distance;
+        closest_item = item;
+      }
+    }
+  }
+
+  if (closest_item == UINT32_MAX) return false;
+  r_hit->item = closest_item;
+  r_hit->distance = closest;
+  return true;
+}
+
+bool BVH::raycast(const glm::vec3& p_origin, const glm::vec3& p_direction, float p_max_distance, BVHHit* r_hit) const
+{
+  return sweep_sphere(p_origin, 0.0f, p_direction, p_max_distance, r_hit);
+}
+
+size_t BVH::overlap(const glm::vec3& p_min, const glm::vec3& p_max, uint32_t* r_items, size_t p_capacity) const
+{
+  if (node_count == 0) return 0;
+
+  auto overlaps = [&](const glm::vec3& p_other_min, const glm::vec3& p_other_max)
+  {
+    return p_min.x <= p_other_max.x && p_max.x >= p_other_min.x
+        && p_min.y <= p_other_max.y && p_max.y >= p_other_min.y
+        && p_min.z <= p_other_max.z && p_max.z >= p_other_min.z;
+  };
+
+  size_t found = 0;
+  uint32_t stack[MAX_DEPTH * 2];
+  int top = 0;
+  stack[top++] = 0;
+
+  while (top > 0)
+  {
+    const BVHNode& node = nodes[stack[--top]];
+    if (!overlaps(node.bounds_min, node.bounds_max)) continue;
+
+    if (node.count == 0)
+    {
+      stack[top++] = node.first;
+      stack[top++] = node.first + 1;
+      continue;
+    }
+
+    for (uint32_t i = node.first; i < node.first + node.count; ++i)
+    {
+      uint32_t item = items[i];
+      if (!overlaps(item_mins[item], item_maxs[item])) continue;
+      if (found < p_capacity) r_items[found] = item;
+      found++;
+    }
+  }
+  return found;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "./culling.h"
+#include "./job_system.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct BVHNode
+{
+  glm::vec3 bounds_min;
+  // Leaf: index of the first item in the item list. Interior: index of the
+  // left child, the right child always follows it.
+  uint32_t first;
+  glm::vec3 bounds_max;
+  // Items in a leaf, 0 for interior nodes.
+  uint32_t count;
+};
+
+struct BVHHit
+{
+  uint32_t item = UINT32_MAX;
+  float distance = 0.0f;
+};
+
+// Bounding volume hierarchy over static items given as AABBs (bricks, level
+// meshes). Built with binned SAH, subtrees are built in parallel on the job
+// system, and the nodes are stored in a flat 32 byte per node array with
+// sibling pairs next to each other. Queries use a fixed stack and don't
+// allocate.
+class BVH
+{
+  public:
+  static constexpr int MAX_DEPTH = 64;
+  static constexpr int SAH_BINS = 16;
+  static constexpr uint32_t MAX_LEAF_ITEMS = 4;
+
+  void build(JobSystem& p_jobs, const glm::vec3* p_mins, const glm::vec3* p_maxs, size_t p_count);
+  void clear();
+
+  // Writes the visible items to r_items, up to p_capacity. Returns how many
+  // are visible, which may exceed p_capacity.
+  size_t cull(const Frustum& p_frustum, uint32_t* r_items, size_t p_capacity) const;
+
+  // Closest item whose box the ray hits within p_max_distance. p_direction
+  // must be normalized.
+  bool raycast(const glm::vec3& p_origin, const glm::vec3& p_direction, float p_max_distance, BVHHit* r_hit) const;
+
+  // Same for a sphere moving along the ray, boxes are inflated by the radius.
+  bool sweep_sphere(const glm::vec3& p_origin, float p_radius, const glm::vec3& p_direction, float p_max_distance, BVHHit* r_hit) const;
+
+  // Items whose box overlaps the given box, same contract as cull().
+  size_t overlap(const glm::vec3& p_min, const glm::vec3& p_max, uint32_t* r_items, size_t p_capacity) const;
+
+  const std::vector<BVHNode>& get_nodes() const { return nodes; }
+  uint32_t get_node_count() const { return node_count; }
+
+  private:
+  struct BuildContext;
+
+  void build_node(BuildContext& p_context, uint32_t p_node, uint32_t p_first, uint32_t p_count, int p_depth);
+
+  std::vector<BVHNode> nodes;
+  std::vector<uint32_t> items;
+  std::vector<glm::vec3> item_mins;
+  std::vector<glm::vec3> item_maxs;
+  // Build scratch, kept so rebuilds reuse the capacity.
+  std::vector<glm::vec3> item_centroids;
+  uint32_t node_count = 0;
+};
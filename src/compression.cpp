@@ -0,0 +1,161 @@
+#include "./compression.h"
+
+#include <cstdint>
+#include <cstring>
+
+static constexpr int HASH_BITS = 12;
+static constexpr size_t MIN_MATCH = 4;
+static constexpr size_t MAX_OFFSET = 65535;
+// The format requires the last match to start 12 bytes before the end and
+// the last 5 bytes to be literals.
+static constexpr size_t END_LITERALS = 5;
+static constexpr size_t LAST_MATCH_START = 12;
+
+static uint32_t read32(const unsigned char* p_ptr)
+{
+  uint32_t value;
+  std::memcpy(&value, p_ptr, sizeof(value));
+  return value;
+}
+
+static unsigned char* write_length(unsigned char* r_op, size_t p_length)
+{
+  while (p_length >= 255)
+  {
+    *r_op++ = 255;
+    p_length -= 255;
+  }
+  *r_op++ = (unsigned char)p_length;
+  return r_op;
+}
+
+size_t Compression::compress(const unsigned char* p_src, size_t p_size, unsigned char* r_dst, size_t p_capacity)
+{
+  // Positions + 1, so 0 means empty.
+  uint32_t table[1 << HASH_BITS];
+  std::memset(table, 0, sizeof(table));
+
+  unsigned char* op = r_dst;
+  unsigned char* op_end = r_dst + p_capacity;
+  size_t anchor = 0;
+  size_t i = 0;
+
+  while (p_size > LAST_MATCH_START && i < p_size - LAST_MATCH_START)
+  {
+    uint32_t sequence = read32(p_src + i);
+    uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+    uint32_t candidate = table[hash];
+    table[hash] = (uint32_t)(i + 1);
+
+    if (candidate == 0 || i - (candidate - 1) > MAX_OFFSET || read32(p_src + candidate - 1) != sequence)
+    {
+      i++;
+      continue;
+    }
+
+    size_t match = candidate - 1;
+    while (i > anchor && match > 0 && p_src[i - 1] == p_src[match - 1])
+    {
+      i--;
+      match--;
+    }
+
+    size_t length = MIN_MATCH;
+    while (i + length < p_size - END_LITERALS && p_src[i + length] == p_src[match + length]) length++;
+
+    size_t literals = i - anchor;
+    if ((size_t)(op_end - op) < literals + literals / 255 + length / 255 + 8) return 0;
+
+    unsigned char* token = op++;
+    *token = (unsigned char)((literals < 15 ? literals : 15) << 4);
+    if (literals >= 15) op = write_length(op, literals - 15);
+    std::memcpy(op, p_src + anchor, literals);
+    op += literals;
+
+    size_t offset = i - match;
+    *op++ = (unsigned char)(offset & 0xFF);
+    *op++ = (unsigned char)(offset >> 8);
+
+    size_t match_code = length - MIN_MATCH;
+    *token |= (unsigned char)(match_code < 15 ? match_code : 15);
+    if (match_code >= 15) op = write_length(op, match_code - 15);
+
+    i += length;
+    anchor = i;
+  }
+
+  // Trailing literals, a sequence without a match.
+  size_t literals = p_size - anchor;
+  if ((size_t)(op_end - op) < literals + literals / 255 + 2) return 0;
+  *op++ = (unsigned char)((literals < 15 ? literals : 15) << 4);
+  if (literals >= 15) op = write_length(op, literals - 15);
+  if (literals > 0) std::memcpy(op, p_src + anchor, literals);
+  op += literals;
+
+  return (size_t)(op - r_dst);
+}
+
+bool Compression::decompress(const unsigned char* p_src, size_t p_size, unsigned char* r_dst, size_t p_dst_size)
+{
+  const unsigned char* ip = p_src;
+  const unsigned char* ip_end = p_src + p_size;
+  unsigned char* op = r_dst;
+  unsigned char* op_end = r_dst + p_dst_size;
+
+  while (ip < ip_end)
+  {
+    unsigned char token = *ip++;
+
+    size_t literals = token >> 4;
+    if (literals == 15)
+    {
+      unsigned char byte;
+      do
+      {
+        if (ip >= ip_end) return false;
+        byte = *ip++;
+        literals += byte;
+      } while (byte == 255);
+    }
+    if ((size_t)(ip_end - ip) < literals || (size_t)(op_end - op) < literals) return false;
+    if (literals > 0) std::memcpy(op, ip, literals);
+    ip += literals;
+    op += literals;
+
+    // The last sequence has no match.
+    if (ip == ip_end) break;
+
+    if (ip_end - ip < 2) return false;
+    size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > (size_t)(op - r_dst)) return false;
+
+    size_t length = token & 15;
+    if (length == 15)
+    {
+      unsigned char byte;
+      do
+      {
+        if (ip >= ip_end) return false;
+        byte = *ip++;
+        length += byte;
+      } while (byte == 255);
+    }
+    length += MIN_MATCH;
+    if ((size_t)(op_end - op) < length) return false;
+
+    // Overlapping copies repeat the last offset bytes, copy forward.
+    const unsigned char* match = op - offset;
+    if (offset >= length)
+    {
+      std::memcpy(op, match, length);
+      op += length;
+    }
+    else
+    {
+      for (size_t i = 0; i < length; ++i) *op++ = match[i];
+    }
+  }
+
+  return op == op_end;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+
+// Byte-oriented LZ77 in the LZ4 block format: fast to decode, no entropy
+// coding. Used for pack entries, where load time matters more than ratio.
+class Compression
+{
+  public:
+  // Worst case compressed size for incompressible input.
+  static size_t get_bound(size_t p_size) { return p_size + p_size / 255 + 16; }
+
+  // Returns the compressed size, or 0 if it didn't fit into p_capacity.
+  static size_t compress(const unsigned char* p_src, size_t p_size, unsigned char* r_dst, size_t p_capacity);
+
+  // p_dst_size must be the exact decompressed size. False on corrupt input.
+  static bool decompress(const unsigned char* p_src, size_t p_size, unsigned char* r_dst, size_t p_dst_size);
+};
@@ -0,0 +1,156 @@
+#include "./culling.h"
+#include "./simd.h"
+
+#include <cmath>
+
+Frustum Frustum::from_matrix(const glm::mat4& p_view_projection)
+{
+  // Gribb/Hartmann, glm is column major so row i is m[0][i] .. m[3][i].
+  const glm::mat4& m = p_view_projection;
+  glm::vec4 row_x { m[0][0], m[1][0], m[2][0], m[3][0] };
+  glm::vec4 row_y { m[0][1], m[1][1], m[2][1], m[3][1] };
+  glm::vec4 row_z { m[0][2], m[1][2], m[2][2], m[3][2] };
+  glm::vec4 row_w { m[0][3], m[1][3], m[2][3], m[3][3] };
+
+  Frustum frustum;
+  frustum.planes[PLANE_LEFT] = row_w + row_x;
+  frustum.planes[PLANE_RIGHT] = row_w - row_x;
+  frustum.planes[PLANE_BOTTOM] = row_w + row_y;
+  frustum.planes[PLANE_TOP] = row_w - row_y;
+  frustum.planes[PLANE_NEAR] = row_w + row_z;
+  frustum.planes[PLANE_FAR] = row_w - row_z;
+
+  for (glm::vec4& plane : frustum.planes)
+  {
+    plane = plane / glm::length(glm::vec3 { plane });
+  }
+  return frustum;
+}
+
+static bool sphere_visible(const Frustum& p_frustum, float p_x, float p_y, float p_z, float p_radius)
+{
+  for (const glm::vec4& plane : p_frustum.planes)
+  {
+    if (plane.x * p_x + plane.y * p_y + plane.z * p_z + plane.w <= -p_radius) return false;
+  }
+  return true;
+}
+
+static bool box_visible(const Frustum& p_frustum, float p_cx, float p_cy, float p_cz, float p_ex, float p_ey, float p_ez)
+{
+  for (const glm::vec4& plane : p_frustum.planes)
+  {
+    float distance = plane.x * p_cx + plane.y * p_cy + plane.z * p_cz + plane.w;
+    float reach = std::fabs(plane.x) * p_ex + std::fabs(plane.y) * p_ey + std::fabs(plane.z) * p_ez;
+    if (distance <= -reach) return false;
+  }
+  return true;
+}
+
+void Culling::cull_spheres(const Frustum& p_frustum, const SphereSoA& p_spheres, size_t p_begin, size_t p_end, uint8_t* r_visible)
+{
+  size_t i = p_begin;
+
+#if SIMD_WIDTH > 1
+  vfloat plane_x[Frustum::PLANE_MAX], plane_y[Frustum::PLANE_MAX], plane_z[Frustum::PLANE_MAX], plane_w[Frustum::PLANE_MAX];
+  for (int p = 0; p < Frustum::PLANE_MAX; ++p)
+  {
+    plane_x[p] = v_set(p_frustum.planes[p].x);
+    plane_y[p] = v_set(p_frustum.planes[p].y);
+    plane_z[p] = v_set(p_frustum.planes[p].z);
+    plane_w[p] = v_set(p_frustum.planes[p].w);
+  }
+
+  const vfloat zero = v_set(0.0f);
+  for (; i + SIMD_WIDTH <= p_end; i += SIMD_WIDTH)
+  {
+    vfloat x = v_load(p_spheres.x + i);
+    vfloat y = v_load(p_spheres.y + i);
+    vfloat z = v_load(p_spheres.z + i);
+    vfloat r = v_load(p_spheres.radius + i);
+
+    // Visible while distance + radius > 0 for every plane.
+    vfloat inside = v_gt(v_add(v_add(v_mul(plane_x[0], x), v_mul(plane_y[0], y)), v_add(v_add(v_mul(plane_z[0], z), plane_w[0]), r)), zero);
+    for (int p = 1; p < Frustum::PLANE_MAX; ++p)
+    {
+      vfloat distance = v_add(v_add(v_mul(plane_x[p], x), v_mul(plane_y[p], y)), v_add(v_add(v_mul(plane_z[p], z), plane_w[p]), r));
+      inside = v_and(inside, v_gt(distance, zero));
+    }
+
+    int mask = v_mask(inside);
+    for (int lane = 0; lane < SIMD_WIDTH; ++lane) r_visible[i + lane] = (mask >> lane) & 1;
+  }
+#endif
+
+  for (; i < p_end; ++i)
+  {
+    r_visible[i] = sphere_visible(p_frustum, p_spheres.x[i], p_spheres.y[i], p_spheres.z[i], p_spheres.radius[i]);
+  }
+}
+
+void Culling::cull_boxes(const Frustum& p_frustum, const BoxSoA& p_boxes, size_t p_begin, size_t p_end, uint8_t* r_visible)
+{
+  size_t i = p_begin;
+
+#if SIMD_WIDTH > 1
+  const vfloat zero = v_set(0.0f);
+  for (; i + SIMD_WIDTH <= p_end; i += SIMD_WIDTH)
+  {
+    vfloat cx = v_load(p_boxes.center_x + i);
+    vfloat cy = v_load(p_boxes.center_y + i);
+    vfloat cz = v_load(p_boxes.center_z + i);
+    vfloat ex = v_load(p_boxes.extent_x + i);
+    vfloat ey = v_load(p_boxes.extent_y + i);
+    vfloat ez = v_load(p_boxes.extent_z + i);
+
+    vfloat inside = v_gt(v_set(1.0f), zero);
+    for (const glm::vec4& plane : p_frustum.planes)
+    {
+      // Distance of the box's most positive corner along the plane normal.
+      vfloat distance = v_add(v_add(v_mul(v_set(plane.x), cx), v_mul(v_set(plane.y), cy)), v_add(v_mul(v_set(plane.z), cz), v_set(plane.w)));
+      vfloat reach = v_add(v_add(v_mul(v_set(std::fabs(plane.x)), ex), v_mul(v_set(std::fabs(plane.y)), ey)), v_mul(v_set(std::fabs(plane.z)), ez));
+      inside = v_and(inside, v_gt(v_add(distance, reach), zero));
+    }
+
+    int mask = v_mask(inside);
+    for (int lane = 0; lane < SIMD_WIDTH; ++lane) r_visible[i + lane] = (mask >> lane) & 1;
+  }
+#endif
+
+  for (; i < p_end; ++i)
+  {
+    r_visible[i] = box_visible(p_frustum, p_boxes.center_x[i], p_boxes.center_y[i], p_boxes.center_z[i], p_boxes.extent_x[i], p_boxes.extent_y[i], p_boxes.extent_z[i]);
+  }
+}
+
+void Culling::cull_spheres(JobSystem& p_jobs, const Frustum& p_frustum, const SphereSoA& p_spheres, uint8_t* r_visible)
+{
+  // Below this the scheduling overhead outweighs the tests.
+  const size_t batch_size = 1024;
+  if (p_spheres.count <= batch_size)
+  {
+    cull_spheres(p_frustum, p_spheres, 0, p_spheres.count, r_visible);
+    return;
+  }
+
+  p_jobs.parallel_for(p_spheres.count, batch_size, [&](size_t p_begin, size_t p_end)
+  {
+    cull_spheres(p_frustum, p_spheres, p_begin, p_end, r_visible);
+  });
+}
+
+size_t Culling::compact(const uint8_t* p_visible, size_t p_count, uint32_t* r_indices)
+{
+  size_t visible_count = 0;
+  for (size_t i = 0; i < p_count; ++i)
+  {
+    r_indices[visible_count] = (uint32_t)i;
+    visible_count += p_visible[i];
+  }
+  return visible_count;
+}
+
+int Culling::get_simd_width()
+{
+  return SIMD_WIDTH;
+}
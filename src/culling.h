@@ -0,0 +1,69 @@
+#pragma once
+
+#include "./job_system.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+// Six normalized planes (xyz = inward normal, w = distance), extracted from a
+// view-projection matrix.
+struct Frustum
+{
+  enum Plane
+  {
+    PLANE_LEFT,
+    PLANE_RIGHT,
+    PLANE_BOTTOM,
+    PLANE_TOP,
+    PLANE_NEAR,
+    PLANE_FAR,
+    PLANE_MAX
+  };
+
+  glm::vec4 planes[PLANE_MAX];
+
+  static Frustum from_matrix(const glm::mat4& p_view_projection);
+};
+
+// Bounding spheres in SoA layout so they can be tested several at a time.
+struct SphereSoA
+{
+  const float* x;
+  const float* y;
+  const float* z;
+  const float* radius;
+  size_t count;
+};
+
+// Axis aligned boxes as center and half extents, SoA.
+struct BoxSoA
+{
+  const float* center_x;
+  const float* center_y;
+  const float* center_z;
+  const float* extent_x;
+  const float* extent_y;
+  const float* extent_z;
+  size_t count;
+};
+
+// Visibility tests, vectorized with AVX (8 wide), SSE or NEON (4 wide) with
+// a scalar fallback. They write one byte per item (1 = visible) into
+// r_visible for [p_begin, p_end), so disjoint ranges can run on different
+// threads.
+class Culling
+{
+  public:
+  static void cull_spheres(const Frustum& p_frustum, const SphereSoA& p_spheres, size_t p_begin, size_t p_end, uint8_t* r_visible);
+  static void cull_boxes(const Frustum& p_frustum, const BoxSoA& p_boxes, size_t p_begin, size_t p_end, uint8_t* r_visible);
+
+  // Splits the work over the job system when there is enough of it.
+  static void cull_spheres(JobSystem& p_jobs, const Frustum& p_frustum, const SphereSoA& p_spheres, uint8_t* r_visible);
+
+  // Writes the indices of visible items to r_indices, returns how many.
+  static size_t compact(const uint8_t* p_visible, size_t p_count, uint32_t* r_indices);
+
+  static int get_simd_width();
+};
@@ -0,0 +1,74 @@
+#include "./frame_arena.h"
+
+#include "./memory_tracker.h"
+
+#include <cstdlib>
+#include <iostream>
+
+FrameArena::FrameArena(size_t p_capacity) :
+    capacity(p_capacity)
+{
+  block = static_cast<unsigned char*>(std::malloc(capacity));
+}
+
+FrameArena::~FrameArena()
+{
+  // Not reset(), that would grow the block just to free it.
+  for (void* ptr : overflow) std::free(ptr);
+  std::free(block);
+}
+
+void* FrameArena::allocate(size_t p_size, size_t p_alignment)
+{
+  size_t aligned = (offset + p_alignment - 1) & ~(p_alignment - 1);
+  used += p_size;
+
+  if (aligned + p_size <= capacity)
+  {
+    offset = aligned + p_size;
+    return block + aligned;
+  }
+
+  // Out of space, serve this one from the heap until the next reset.
+  void* ptr = std::aligned_alloc(p_alignment, (p_size + p_alignment - 1) & ~(p_alignment - 1));
+  if (ptr == nullptr) throw std::bad_alloc {};
+  overflow.push_back(ptr);
+  return ptr;
+}
+
+void FrameArena::reset()
+{
+  if (used > peak) peak = used;
+
+  if (!overflow.empty())
+  {
+    for (void* ptr : overflow) std::free(ptr);
+    overflow.clear();
+
+    // Grow so the same workload fits next frame. Keep some slack for alignment.
+    capacity = peak + peak / 4;
+    std::free(block);
+    block = static_cast<unsigned char*>(std::malloc(capacity));
+    std::cerr << "FRAME_ARENA::GROW " << capacity << " bytes" << std::endl;
+  }
+
+  offset = 0;
+  used = 0;
+}
+
+FrameArenas::FrameArenas(size_t p_capacity) :
+    arenas { FrameArena { p_capacity }, FrameArena { p_capacity } }
+{
+}
+
+FrameArena& FrameArenas::begin_frame()
+{
+  index ^= 1;
+  arenas[index].reset();
+  return arenas[index];
+}
+
+uint64_t HeapCounter::get_count()
+{
+  return MemoryTracker::get_allocation_count();
+}
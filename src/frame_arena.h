@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// Linear allocator for data that only lives until the end of a frame.
+// Allocations are a pointer bump, nothing is freed individually and reset()
+// releases everything at once. If a frame outgrows the block, the overflow is
+// served from the heap and the block grows to the high-water mark on the next
+// reset, so steady state does no heap allocations.
+class FrameArena
+{
+  public:
+  explicit FrameArena(size_t p_capacity);
+  ~FrameArena();
+
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  void* allocate(size_t p_size, size_t p_alignment = alignof(std::max_align_t));
+  void reset();
+
+  template <typename T>
+  T* allocate_array(size_t p_count)
+  {
+    return static_cast<T*>(allocate(p_count * sizeof(T), alignof(T)));
+  }
+
+  size_t get_capacity() const { return capacity; }
+  size_t get_used() const { return used; }
+  size_t get_peak() const { return peak; }
+
+  private:
+  unsigned char* block = nullptr;
+  size_t capacity = 0;
+  size_t offset = 0;
+
+  // Bytes handed out this frame, including overflow.
+  size_t used = 0;
+  size_t peak = 0;
+
+  std::vector<void*> overflow;
+};
+
+// Two arenas used alternately, so data written for frame N stays valid while
+// frame N is consumed elsewhere (e.g. by the render thread) and frame N + 1 is
+// being built. The caller guarantees the consumer is done with frame N - 1
+// before calling begin_frame().
+class FrameArenas
+{
+  public:
+  explicit FrameArenas(size_t p_capacity);
+
+  FrameArena& begin_frame();
+  FrameArena& current() { return arenas[index]; }
+  FrameArena& previous() { return arenas[index ^ 1]; }
+
+  private:
+  FrameArena arenas[2];
+  unsigned int index = 0;
+};
+
+// STL-compatible adapter, deallocate() is a no-op since the arena frees
+// everything on reset.
+template <typename T>
+class ArenaAllocator
+{
+  public:
+  using value_type = T;
+
+  ArenaAllocator(FrameArena& p_arena) :
+      arena(&p_arena) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& p_other) :
+      arena(p_other.arena) {}
+
+  T* allocate(size_t p_count) { return arena->allocate_array<T>(p_count); }
+  void deallocate(T*, size_t) {}
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& p_other) const { return arena == p_other.arena; }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>& p_other) const { return arena != p_other.arena; }
+
+  FrameArena* arena;
+};
+
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+// Counts calls to the global operator new, all memory tags (see
+// MemoryTracker).
+class HeapCounter
+{
+  public:
+  static uint64_t get_count();
+};
@@ -0,0 +1,134 @@
+#include "./geometry_pool.h"
+
+#include "./memory_tracker.h"
+
+#include <iostream>
+
+void GeometryPool::init(GLStateCache& p_state, uint32_t p_max_vertices, uint32_t p_max_indices)
+{
+  max_vertices = p_max_vertices;
+  max_indices = p_max_indices;
+
+  glGenVertexArrays(1, &vao);
+  glGenBuffers(1, &vertex_buffer);
+  glGenBuffers(1, &index_buffer);
+
+  // The element array binding is VAO state, bind the VAO first.
+  p_state.bind_vertex_array(vao);
+
+  p_state.bind_buffer(GL_ARRAY_BUFFER, vertex_buffer);
+  glBufferData(GL_ARRAY_BUFFER, max_vertices * sizeof(Vertex), nullptr, GL_STATIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tex_coord));
+
+  p_state.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, max_indices * sizeof(uint32_t), nullptr, GL_STATIC_DRAW);
+
+  MemoryTracker::add_gpu(MEMORY_TAG_ASSETS, get_gpu_bytes());
+}
+
+void GeometryPool::destroy()
+{
+  glDeleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vertex_buffer);
+  glDeleteBuffers(1, &index_buffer);
+  MemoryTracker::remove_gpu(MEMORY_TAG_ASSETS, get_gpu_bytes());
+  vertex_count = 0;
+  index_count = 0;
+  free_vertices.clear();
+  free_indices.clear();
+}
+
+bool GeometryPool::allocate(std::vector<Span>& r_free, uint32_t& r_top, uint32_t p_max, uint32_t p_count, uint32_t* r_start)
+{
+  for (size_t i = 0; i < r_free.size(); ++i)
+  {
+    Span& span = r_free[i];
+    if (span.count < p_count) continue;
+
+    *r_start = span.start;
+    span.start += p_count;
+    span.count -= p_count;
+    if (span.count == 0) r_free.erase(r_free.begin() + i);
+    return true;
+  }
+
+  if (r_top + p_count > p_max) return false;
+  *r_start = r_top;
+  r_top += p_count;
+  return true;
+}
+
+void GeometryPool::release(std::vector<Span>& r_free, uint32_t& r_top, uint32_t p_start, uint32_t p_count)
+{
+  if (p_count == 0) return;
+
+  size_t i = 0;
+  while (i < r_free.size() && r_free[i].start < p_start) ++i;
+  r_free.insert(r_free.begin() + i, Span { p_start, p_count });
+
+  // Merge with the following hole, then with the previous one.
+  if (i + 1 < r_free.size() && r_free[i].start + r_free[i].count == r_free[i + 1].start)
+  {
+    r_free[i].count += r_free[i + 1].count;
+    r_free.erase(r_free.begin() + i + 1);
+  }
+  if (i > 0 && r_free[i - 1].start + r_free[i - 1].count == r_free[i].start)
+  {
+    r_free[i - 1].count += r_free[i].count;
+    r_free.erase(r_free.begin() + i);
+    --i;
+  }
+
+  // A hole at the end just lowers the top.
+  if (r_free[i].start + r_free[i].count == r_top)
+  {
+    r_top = r_free[i].start;
+    r_free.erase(r_free.begin() + i);
+  }
+}
+
+void GeometryPool::free(const GeometryRange& p_range)
+{
+  release(free_vertices, vertex_count, (uint32_t)p_range.base_vertex, p_range.vertex_count);
+  release(free_indices, index_count, p_range.first_index, p_range.index_count);
+}
+
+GeometryRange GeometryPool::add(GLStateCache& p_state, const float* p_positions, const float* p_tex_coords, uint32_t p_vertex_count, const uint32_t* p_indices, uint32_t p_index_count)
+{
+  uint32_t first_vertex = 0;
+  uint32_t first_index = 0;
+  bool fits = allocate(free_vertices, vertex_count, max_vertices, p_vertex_count, &first_vertex);
+  if (fits && !allocate(free_indices, index_count, max_indices, p_index_count, &first_index))
+  {
+    release(free_vertices, vertex_count, first_vertex, p_vertex_count);
+    fits = false;
+  }
+  if (!fits)
+  {
+    std::cerr << "ERROR::GEOMETRY_POOL::FULL " << p_vertex_count << " vertices, " << p_index_count << " indices" << std::endl;
+    return GeometryRange {};
+  }
+
+  std::vector<Vertex> vertices(p_vertex_count);
+  for (uint32_t i = 0; i < p_vertex_count; ++i)
+  {
+    vertices[i].position = glm::vec3 { p_positions[i * 3], p_positions[i * 3 + 1], p_positions[i * 3 + 2] };
+    vertices[i].tex_coord = p_tex_coords ? glm::vec2 { p_tex_coords[i * 2], p_tex_coords[i * 2 + 1] } : glm::vec2 { 0.0f };
+  }
+
+  p_state.bind_vertex_array(vao);
+  p_state.bind_buffer(GL_ARRAY_BUFFER, vertex_buffer);
+  glBufferSubData(GL_ARRAY_BUFFER, first_vertex * sizeof(Vertex), p_vertex_count * sizeof(Vertex), vertices.data());
+  p_state.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, first_index * sizeof(uint32_t), p_index_count * sizeof(uint32_t), p_indices);
+
+  GeometryRange range;
+  range.first_index = first_index;
+  range.index_count = p_index_count;
+  range.base_vertex = (int32_t)first_vertex;
+  range.vertex_count = p_vertex_count;
+  return range;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "./gl_state_cache.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Interleaved vertex layout of every mesh in the pool.
+struct Vertex
+{
+  glm::vec3 position;
+  glm::vec2 tex_coord;
+};
+
+// Sub-range of the pool holding one mesh. Indices are relative to the mesh's
+// own vertices, base_vertex is added by the draw call.
+struct GeometryRange
+{
+  uint32_t first_index = 0;
+  uint32_t index_count = 0;
+  int32_t base_vertex = 0;
+  uint32_t vertex_count = 0;
+};
+
+// Static geometry for all meshes in one vertex buffer and one index buffer.
+// Ranges are first-fit sub-allocated from the freed holes, then from the end.
+// Everything shares a single VAO, so switching meshes is just a different
+// offset in the draw call. Render thread (or the thread owning the context
+// during setup) only.
+class GeometryPool
+{
+  public:
+  void init(GLStateCache& p_state, uint32_t p_max_vertices, uint32_t p_max_indices);
+  void destroy();
+
+  // Copies a mesh into the pool. Returns an empty range (index_count 0) if
+  // it doesn't fit.
+  GeometryRange add(GLStateCache& p_state, const float* p_positions, const float* p_tex_coords, uint32_t p_vertex_count, const uint32_t* p_indices, uint32_t p_index_count);
+
+  // The range may be reused by the next add(), so nothing in flight may
+  // still draw from it.
+  void free(const GeometryRange& p_range);
+
+  GLuint get_vao() const { return vao; }
+  // High-water marks, holes included.
+  uint32_t get_vertex_count() const { return vertex_count; }
+  uint32_t get_index_count() const { return index_count; }
+
+  // Both buffers at full capacity, what the driver allocates up front.
+  size_t get_gpu_bytes() const { return max_vertices * sizeof(Vertex) + max_indices * sizeof(uint32_t); }
+
+  private:
+  struct Span
+  {
+    uint32_t start;
+    uint32_t count;
+  };
+
+  static bool allocate(std::vector<Span>& r_free, uint32_t& r_top, uint32_t p_max, uint32_t p_count, uint32_t* r_start);
+  static void release(std::vector<Span>& r_free, uint32_t& r_top, uint32_t p_start, uint32_t p_count);
+
+  GLuint vao = 0;
+  GLuint vertex_buffer = 0;
+  GLuint index_buffer = 0;
+
+  uint32_t max_vertices = 0;
+  uint32_t max_indices = 0;
+  uint32_t vertex_count = 0;
+  uint32_t index_count = 0;
+
+  // Sorted by start, adjacent holes are merged.
+  std::vector<Span> free_vertices;
+  std::vector<Span> free_indices;
+};
@@ -0,0 +1,198 @@
+#include "./gl_state_cache.h"
+
+#include <cassert>
+
+static constexpr GLuint UNKNOWN = UINT32_MAX;
+
+GLStateCache::GLStateCache()
+{
+  invalidate();
+}
+
+void GLStateCache::invalidate()
+{
+  program = UNKNOWN;
+  vao = UNKNOWN;
+  for (GLuint& buffer : buffers) buffer = UNKNOWN;
+  for (BufferRange& range : uniform_ranges) range = { UNKNOWN, 0, 0 };
+  for (int i = 0; i < MAX_TEXTURE_UNITS; ++i)
+  {
+    textures[i] = UNKNOWN;
+    texture_targets[i] = 0;
+  }
+  active_unit = UNKNOWN;
+  for (int8_t& capability : capabilities) capability = -1;
+  for (float& channel : clear_rgba) channel = -1.0f;
+  blend_src = 0;
+  blend_dst = 0;
+  depth_write = -1;
+}
+
+void GLStateCache::begin_frame()
+{
+  issued_last_frame = issued;
+  saved_last_frame = saved;
+  draws_last_frame = draws;
+  triangles_last_frame = triangles;
+  issued = 0;
+  saved = 0;
+  draws = 0;
+  triangles = 0;
+}
+
+int GLStateCache::capability_index(GLenum p_capability)
+{
+  switch (p_capability)
+  {
+  case GL_DEPTH_TEST: return CAP_DEPTH_TEST;
+  case GL_CULL_FACE: return CAP_CULL_FACE;
+  case GL_BLEND: return CAP_BLEND;
+  case GL_SCISSOR_TEST: return CAP_SCISSOR_TEST;
+  case GL_RASTERIZER_DISCARD: return CAP_RASTERIZER_DISCARD;
+  case GL_PROGRAM_POINT_SIZE: return CAP_PROGRAM_POINT_SIZE;
+  default: return -1;
+  }
+}
+
+int GLStateCache::buffer_index(GLenum p_target)
+{
+  switch (p_target)
+  {
+  case GL_ARRAY_BUFFER: return BUFFER_ARRAY;
+  case GL_ELEMENT_ARRAY_BUFFER: return BUFFER_ELEMENT_ARRAY;
+  case GL_UNIFORM_BUFFER: return BUFFER_UNIFORM;
+  case GL_PIXEL_UNPACK_BUFFER: return BUFFER_PIXEL_UNPACK;
+  case GL_COPY_READ_BUFFER: return BUFFER_COPY_READ;
+  case GL_COPY_WRITE_BUFFER: return BUFFER_COPY_WRITE;
+  case GL_TRANSFORM_FEEDBACK_BUFFER: return BUFFER_TRANSFORM_FEEDBACK;
+  default: return -1;
+  }
+}
+
+void GLStateCache::use_program(GLuint p_program)
+{
+  if (program == p_program ? unchanged() : changed())
+  {
+    program = p_program;
+    glUseProgram(p_program);
+  }
+}
+
+void GLStateCache::bind_vertex_array(GLuint p_vao)
+{
+  if (vao == p_vao ? unchanged() : changed())
+  {
+    vao = p_vao;
+    glBindVertexArray(p_vao);
+    // The element array binding is VAO state.
+    buffers[BUFFER_ELEMENT_ARRAY] = UNKNOWN;
+  }
+}
+
+void GLStateCache::bind_buffer(GLenum p_target, GLuint p_buffer)
+{
+  int index = buffer_index(p_target);
+  if (index < 0)
+  {
+    changed();
+    glBindBuffer(p_target, p_buffer);
+    return;
+  }
+
+  if (buffers[index] == p_buffer ? unchanged() : changed())
+  {
+    buffers[index] = p_buffer;
+    glBindBuffer(p_target, p_buffer);
+  }
+}
+
+void GLStateCache::bind_buffer_range(GLenum p_target, GLuint p_index, GLuint p_buffer, GLintptr p_offset, GLsizeiptr p_size)
+{
+  if (p_target == GL_UNIFORM_BUFFER && p_index < MAX_UNIFORM_BINDINGS)
+  {
+    BufferRange& range = uniform_ranges[p_index];
+    if (range.buffer == p_buffer && range.offset == p_offset && range.size == p_size)
+    {
+      unchanged();
+      return;
+    }
+    range = { p_buffer, p_offset, p_size };
+  }
+
+  changed();
+  glBindBufferRange(p_target, p_index, p_buffer, p_offset, p_size);
+
+  // Also replaces the generic binding of the target.
+  int index = buffer_index(p_target);
+  if (index >= 0) buffers[index] = p_buffer;
+}
+
+void GLStateCache::bind_texture(unsigned int p_unit, GLenum p_target, GLuint p_texture)
+{
+  assert(p_unit < MAX_TEXTURE_UNITS);
+  if (textures[p_unit] == p_texture && texture_targets[p_unit] == p_target)
+  {
+    unchanged();
+    return;
+  }
+
+  if (active_unit != p_unit)
+  {
+    changed();
+    active_unit = p_unit;
+    glActiveTexture(GL_TEXTURE0 + p_unit);
+  }
+
+  changed();
+  textures[p_unit] = p_texture;
+  texture_targets[p_unit] = p_target;
+  glBindTexture(p_target, p_texture);
+}
+
+void GLStateCache::set_enabled(GLenum p_capability, bool p_enabled)
+{
+  int index = capability_index(p_capability);
+  if (index >= 0 && capabilities[index] == (int8_t)p_enabled)
+  {
+    unchanged();
+    return;
+  }
+
+  changed();
+  if (index >= 0) capabilities[index] = p_enabled;
+  if (p_enabled)
+    glEnable(p_capability);
+  else
+    glDisable(p_capability);
+}
+
+void GLStateCache::clear_color(float p_r, float p_g, float p_b, float p_a)
+{
+  if (clear_rgba[0] == p_r && clear_rgba[1] == p_g && clear_rgba[2] == p_b && clear_rgba[3] == p_a ? unchanged() : changed())
+  {
+    clear_rgba[0] = p_r;
+    clear_rgba[1] = p_g;
+    clear_rgba[2] = p_b;
+    clear_rgba[3] = p_a;
+    glClearColor(p_r, p_g, p_b, p_a);
+  }
+}
+
+void GLStateCache::blend_func(GLenum p_src, GLenum p_dst)
+{
+  if (blend_src == p_src && blend_dst == p_dst ? unchanged() : changed())
+  {
+    blend_src = p_src;
+    blend_dst = p_dst;
+    glBlendFunc(p_src, p_dst);
+  }
+}
+
+void GLStateCache::depth_mask(bool p_enabled)
+{
+  if (depth_write == (int8_t)p_enabled ? unchanged() : changed())
+  {
+    depth_write = p_enabled;
+    glDepthMask(p_enabled);
+  }
+}
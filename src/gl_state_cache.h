@@ -0,0 +1,110 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+
+// Shadow copy of the GL state we touch, so redundant binds and enables are
+// dropped before they reach the driver. Everything that changes this state
+// must go through here, otherwise call invalidate() afterwards. Render thread
+// only.
+class GLStateCache
+{
+  public:
+  static constexpr int MAX_TEXTURE_UNITS = 16;
+  static constexpr int MAX_UNIFORM_BINDINGS = 8;
+
+  GLStateCache();
+
+  // Forget everything, the next call of each kind always reaches GL.
+  void invalidate();
+
+  // Rolls the per-frame counters over.
+  void begin_frame();
+
+  void use_program(GLuint p_program);
+  void bind_vertex_array(GLuint p_vao);
+  void bind_buffer(GLenum p_target, GLuint p_buffer);
+  void bind_buffer_range(GLenum p_target, GLuint p_index, GLuint p_buffer, GLintptr p_offset, GLsizeiptr p_size);
+  // p_unit must be below MAX_TEXTURE_UNITS.
+  void bind_texture(unsigned int p_unit, GLenum p_target, GLuint p_texture);
+  void set_enabled(GLenum p_capability, bool p_enabled);
+  void clear_color(float p_r, float p_g, float p_b, float p_a);
+  void blend_func(GLenum p_src, GLenum p_dst);
+  void depth_mask(bool p_enabled);
+
+  void enable(GLenum p_capability) { set_enabled(p_capability, true); }
+  void disable(GLenum p_capability) { set_enabled(p_capability, false); }
+
+  // Draws don't touch the cached state, they only go through here to be
+  // counted. Strips and instanced quads count their actual triangles.
+  void count_draw(uint32_t p_triangles)
+  {
+    draws++;
+    triangles += p_triangles;
+  }
+
+  uint32_t get_issued_last_frame() const { return issued_last_frame; }
+  uint32_t get_saved_last_frame() const { return saved_last_frame; }
+  uint32_t get_draws_last_frame() const { return draws_last_frame; }
+  uint32_t get_triangles_last_frame() const { return triangles_last_frame; }
+
+  private:
+  enum Capability
+  {
+    CAP_DEPTH_TEST,
+    CAP_CULL_FACE,
+    CAP_BLEND,
+    CAP_SCISSOR_TEST,
+    CAP_RASTERIZER_DISCARD,
+    CAP_PROGRAM_POINT_SIZE,
+    CAP_MAX
+  };
+
+  enum BufferTarget
+  {
+    BUFFER_ARRAY,
+    BUFFER_ELEMENT_ARRAY,
+    BUFFER_UNIFORM,
+    BUFFER_PIXEL_UNPACK,
+    BUFFER_COPY_READ,
+    BUFFER_COPY_WRITE,
+    BUFFER_TRANSFORM_FEEDBACK,
+    BUFFER_MAX
+  };
+
+  static int capability_index(GLenum p_capability);
+  static int buffer_index(GLenum p_target);
+
+  bool changed() { issued++; return true; }
+  bool unchanged() { saved++; return false; }
+
+  // UINT32_MAX / -1 mean unknown.
+  GLuint program;
+  GLuint vao;
+  GLuint buffers[BUFFER_MAX];
+  struct BufferRange
+  {
+    GLuint buffer;
+    GLintptr offset;
+    GLsizeiptr size;
+  };
+  BufferRange uniform_ranges[MAX_UNIFORM_BINDINGS];
+  GLuint textures[MAX_TEXTURE_UNITS];
+  GLenum texture_targets[MAX_TEXTURE_UNITS];
+  unsigned int active_unit;
+  int8_t capabilities[CAP_MAX];
+  float clear_rgba[4];
+  GLenum blend_src;
+  GLenum blend_dst;
+  int8_t depth_write;
+
+  uint32_t issued = 0;
+  uint32_t saved = 0;
+  uint32_t issued_last_frame = 0;
+  uint32_t saved_last_frame = 0;
+  uint32_t draws = 0;
+  uint32_t triangles = 0;
+  uint32_t draws_last_frame = 0;
+  uint32_t triangles_last_frame = 0;
+};
@@ -0,0 +1,635 @@
+#include "./gltf_parser.h"
+
+#include "./frame_arena.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+// Pull reader over the JSON text. Containers are walked with
+// next_key()/next_element(), values that aren't needed are skipped in place.
+// The first error sticks and makes every later call fail.
+struct JsonReader
+{
+  JsonReader(const char* p_begin, const char* p_end, FrameArena& p_arena) :
+      begin(p_begin),
+      cursor(p_begin),
+      end(p_end),
+      arena(p_arena)
+  {
+  }
+
+  const char* begin;
+  const char* cursor;
+  const char* end;
+  FrameArena& arena;
+  bool failed = false;
+
+  // Elements of the arrays being parsed, one buffer per nesting level (a
+  // node's children inside the nodes array) reused for the whole document,
+  // see ArrayBuilder.
+  static constexpr int MAX_ARRAY_DEPTH = 2;
+  std::vector<unsigned char> scratch[MAX_ARRAY_DEPTH];
+  int array_depth = 0;
+
+  bool fail()
+  {
+    if (!failed) std::cerr << "ERROR::GLTF::PARSE at offset " << (cursor - begin) << std::endl;
+    failed = true;
+    return false;
+  }
+
+  void skip_whitespace()
+  {
+    while (cursor < end && (*cursor == ' ' || *cursor == '\n' || *cursor == '\r' || *cursor == '\t')) cursor++;
+  }
+
+  char peek()
+  {
+    skip_whitespace();
+    return cursor < end ? *cursor : '\0';
+  }
+
+  bool expect(char p_char)
+  {
+    if (failed || peek() != p_char) return fail();
+    cursor++;
+    return true;
+  }
+
+  // Consumes the separator before the next member, false at the closing
+  // bracket.
+  bool next(char p_close, bool& r_first)
+  {
+    if (failed) return false;
+    char c = peek();
+    if (c == p_close)
+    {
+      cursor++;
+      return false;
+    }
+    if (!r_first && !expect(',')) return false;
+    r_first = false;
+    if (peek() == p_close) return fail();
+    return true;
+  }
+
+  bool next_element(bool& r_first) { return next(']', r_first); }
+
+  // Keys are returned raw, glTF keys never need unescaping.
+  bool next_key(bool& r_first, std::string_view& r_key)
+  {
+    if (!next('}', r_first)) return false;
+    if (!read_raw_string(r_key)) return false;
+    return expect(':');
+  }
+
+  // Contents between the quotes, escapes left as they are.
+  bool read_raw_string(std::string_view& r_string)
+  {
+    if (!expect('"')) return false;
+    const char* start = cursor;
+    while (cursor < end && *cursor != '"')
+    {
+      if (*cursor == '\\') cursor++;
+      cursor++;
+    }
+    if (cursor >= end) return fail();
+    r_string = std::string_view { start, (size_t)(cursor - start) };
+    cursor++;
+    return true;
+  }
+
+  bool read_string(std::string_view& r_string)
+  {
+    std::string_view raw;
+    if (!read_raw_string(raw)) return false;
+    if (raw.find('\\') == std::string_view::npos)
+    {
+      r_string = raw;
+      return true;
+    }
+
+    // Unescaped text is never longer than the escaped one.
+    char* out = arena.allocate_array<char>(raw.size());
+    size_t length = 0;
+    for (size_t i = 0; i < raw.size(); ++i)
+    {
+      char c = raw[i];
+      if (c != '\\')
+      {
+        out[length++] = c;
+        continue;
+      }
+
+      c = raw[++i];
+      switch (c)
+      {
+        case 'b': out[length++] = '\b'; break;
+        case 'f': out[length++] = '\f'; break;
+        case 'n': out[length++] = '\n'; break;
+        case 'r': out[length++] = '\r'; break;
+        case 't': out[length++] = '\t'; break;
+        case 'u':
+        {
+          uint32_t code = 0;
+          if (!read_hex4(raw, i + 1, code)) return fail();
+          i += 4;
+          // Surrogate pair.
+          if (code >= 0xD800 && code < 0xDC00 && i + 6 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u')
+          {
+            uint32_t low = 0;
+            if (!read_hex4(raw, i + 3, low) || low < 0xDC00 || low >= 0xE000) return fail();
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            i += 6;
+          }
+          length += encode_utf8(code, out + length);
+          break;
+        }
+        default: out[length++] = c; break;
+      }
+    }
+    r_string = std::string_view { out, length };
+    return true;
+  }
+
+  static bool read_hex4(std::string_view p_string, size_t p_offset, uint32_t& r_code)
+  {
+    if (p_offset + 4 > p_string.size()) return false;
+    r_code = 0;
+    for (size_t i = p_offset; i < p_offset + 4; ++i)
+    {
+      char c = p_string[i];
+      uint32_t digit;
+      if (c >= '0' && c <= '9')
+        digit = c - '0';
+      else if (c >= 'a' && c <= 'f')
+        digit = c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F')
+        digit = c - 'A' + 10;
+      else
+        return false;
+      r_code = r_code << 4 | digit;
+    }
+    return true;
+  }
+
+  // At most 4 bytes, which \uXXXX plus 2 of its 6 characters cover.
+  static size_t encode_utf8(uint32_t p_code, char* r_out)
+  {
+    if (p_code < 0x80)
+    {
+      r_out[0] = (char)p_code;
+      return 1;
+    }
+    if (p_code < 0x800)
+    {
+      r_out[0] = (char)(0xC0 | p_code >> 6);
+      r_out[1] = (char)(0x80 | (p_code & 0x3F));
+      return 2;
+    }
+    if (p_code < 0x10000)
+    {
+      r_out[0] = (char)(0xE0 | p_code >> 12);
+      r_out[1] = (char)(0x80 | (p_code >> 6 & 0x3F));
+      r_out[2] = (char)(0x80 | (p_code & 0x3F));
+      return 3;
+    }
+    r_out[0] = (char)(0xF0 | p_code >> 18);
+    r_out[1] = (char)(0x80 | (p_code >> 12 & 0x3F));
+    r_out[2] = (char)(0x80 | (p_code >> 6 & 0x3F));
+    r_out[3] = (char)(0x80 | (p_code & 0x3F));
+    return 4;
+  }
+
+  bool read_number(double& r_value)
+  {
+    if (failed) return false;
+    skip_whitespace();
+    const char* start = cursor;
+    bool integer = true;
+    uint64_t magnitude = 0;
+    if (cursor < end && *cursor == '-') cursor++;
+    for (; cursor < end; ++cursor)
+    {
+      char c = *cursor;
+      if (c >= '0' && c <= '9')
+        magnitude = magnitude * 10 + (c - '0');
+      else if (c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-')
+        integer = false;
+      else
+        break;
+    }
+
+    // Most glTF numbers are indices and counts, skip strtod for those.
+    size_t length = cursor - start;
+    bool negative = length > 0 && *start == '-';
+    if (integer && length > (size_t)negative && length <= 18)
+    {
+      r_value = negative ? -(double)magnitude : (double)magnitude;
+      return true;
+    }
+
+    // strtod needs a terminator, the text isn't terminated.
+    char buffer[64];
+    if (length == 0 || length >= sizeof(buffer)) return fail();
+    std::memcpy(buffer, start, length);
+    buffer[length] = '\0';
+
+    char* parsed_end;
+    r_value = std::strtod(buffer, &parsed_end);
+    if (parsed_end != buffer + length) return fail();
+    return true;
+  }
+
+  bool read_uint(uint32_t& r_value)
+  {
+    double value;
+    if (!read_number(value)) return false;
+    if (value < 0.0 || value > 4294967295.0 || value != (double)(uint32_t)value) return fail();
+    r_value = (uint32_t)value;
+    return true;
+  }
+
+  bool read_index(int32_t& r_value)
+  {
+    uint32_t value;
+    if (!read_uint(value)) return false;
+    if (value > INT32_MAX) return fail();
+    r_value = (int32_t)value;
+    return true;
+  }
+
+  bool read_floats(float* r_values, size_t p_count)
+  {
+    if (!expect('[')) return false;
+    bool first = true;
+    size_t count = 0;
+    while (next_element(first))
+    {
+      double value;
+      if (count >= p_count || !read_number(value)) return fail();
+      r_values[count++] = (float)value;
+    }
+    return !failed && count == p_count;
+  }
+
+  bool skip_literal(const char* p_literal)
+  {
+    size_t length = std::strlen(p_literal);
+    if ((size_t)(end - cursor) < length || std::memcmp(cursor, p_literal, length) != 0) return fail();
+    cursor += length;
+    return true;
+  }
+
+  // Skips any value. Nesting is tracked with a counter, strings are the only
+  // thing inside containers that can hide brackets.
+  bool skip_value()
+  {
+    char c = peek();
+    if (c == '"')
+    {
+      std::string_view ignored;
+      return read_raw_string(ignored);
+    }
+    if (c == 't') return skip_literal("true");
+    if (c == 'f') return skip_literal("false");
+    if (c == 'n') return skip_literal("null");
+    if (c != '{' && c != '[')
+    {
+      double ignored;
+      return read_number(ignored);
+    }
+
+    size_t depth = 0;
+    while (cursor < end)
+    {
+      c = *cursor;
+      if (c == '"')
+      {
+        std::string_view ignored;
+        if (!read_raw_string(ignored)) return false;
+        continue;
+      }
+      cursor++;
+      if (c == '{' || c == '[')
+        depth++;
+      else if ((c == '}' || c == ']') && --depth == 0)
+        return true;
+    }
+    return fail();
+  }
+};
+
+// Array filled in order as its elements are parsed, so the text is only read
+// once. Elements collect in the reader's scratch buffer for the builder's
+// nesting level and are copied to the arena at their final size by finish().
+template <typename T>
+struct ArrayBuilder
+{
+  static_assert(std::is_trivially_copyable<T>::value, "elements are moved with memcpy");
+
+  JsonReader& reader;
+  std::vector<unsigned char>& scratch;
+  uint32_t count = 0;
+
+  ArrayBuilder(JsonReader& p_reader) :
+      reader(p_reader), scratch(p_reader.scratch[p_reader.array_depth++])
+  {
+    scratch.clear();
+  }
+
+  ~ArrayBuilder() { reader.array_depth--; }
+
+  // Valid until the next push().
+  T* push()
+  {
+    scratch.resize((size_t)(count + 1) * sizeof(T));
+    return new (scratch.data() + (size_t)count++ * sizeof(T)) T {};
+  }
+
+  GltfArray<T> finish()
+  {
+    GltfArray<T> array;
+    array.count = count;
+    if (count > 0)
+    {
+      array.data = reader.arena.allocate_array<T>(count);
+      std::memcpy(array.data, scratch.data(), (size_t)count * sizeof(T));
+    }
+    return array;
+  }
+};
+
+static uint32_t get_type_components(std::string_view p_type)
+{
+  if (p_type == "SCALAR") return 1;
+  if (p_type == "VEC2") return 2;
+  if (p_type == "VEC3") return 3;
+  if (p_type == "VEC4") return 4;
+  if (p_type == "MAT2") return 4;
+  if (p_type == "MAT3") return 9;
+  if (p_type == "MAT4") return 16;
+  return 0;
+}
+
+// Calls p_element once per element of an array of objects.
+template <typename T, typename F>
+static bool parse_array(JsonReader& p_reader, GltfArray<T>& r_array, F p_element)
+{
+  ArrayBuilder<T> builder { p_reader };
+  if (!p_reader.expect('[')) return false;
+  bool first = true;
+  while (p_reader.next_element(first))
+  {
+    T* element = builder.push();
+    if (!p_reader.expect('{')) return false;
+    bool first_key = true;
+    std::string_view key;
+    while (p_reader.next_key(first_key, key))
+    {
+      if (!p_element(key, *element)) return false;
+    }
+  }
+  r_array = builder.finish();
+  return !p_reader.failed;
+}
+
+static bool parse_buffer(JsonReader& p_reader, std::string_view p_key, GltfBuffer& r_buffer)
+{
+  if (p_key == "uri") return p_reader.read_string(r_buffer.uri);
+  if (p_key == "byteLength") return p_reader.read_uint(r_buffer.byte_length);
+  return p_reader.skip_value();
+}
+
+static bool parse_buffer_view(JsonReader& p_reader, std::string_view p_key, GltfBufferView& r_view)
+{
+  if (p_key == "buffer") return p_reader.read_index(r_view.buffer);
+  if (p_key == "byteOffset") return p_reader.read_uint(r_view.byte_offset);
+  if (p_key == "byteLength") return p_reader.read_uint(r_view.byte_length);
+  if (p_key == "byteStride") return p_reader.read_uint(r_view.byte_stride);
+  return p_reader.skip_value();
+}
+
+static bool parse_accessor(JsonReader& p_reader, std::string_view p_key, GltfAccessor& r_accessor)
+{
+  if (p_key == "bufferView") return p_reader.read_index(r_accessor.buffer_view);
+  if (p_key == "byteOffset") return p_reader.read_uint(r_accessor.byte_offset);
+  if (p_key == "count") return p_reader.read_uint(r_accessor.count);
+  if (p_key == "componentType") return p_reader.read_uint(r_accessor.component_type);
+  if (p_key == "type")
+  {
+    std::string_view type;
+    if (!p_reader.read_raw_string(type)) return false;
+    r_accessor.components = get_type_components(type);
+    return r_accessor.components != 0 || p_reader.fail();
+  }
+  return p_reader.skip_value();
+}
+
+static bool parse_primitive(JsonReader& p_reader, std::string_view p_key, GltfPrimitive& r_primitive)
+{
+  if (p_key == "indices") return p_reader.read_index(r_primitive.indices);
+  if (p_key == "material") return p_reader.read_index(r_primitive.material);
+  if (p_key == "mode") return p_reader.read_uint(r_primitive.mode);
+  if (p_key != "attributes") return p_reader.skip_value();
+
+  if (!p_reader.expect('{')) return false;
+  bool first = true;
+  std::string_view name;
+  while (p_reader.next_key(first, name))
+  {
+    bool ok;
+    if (name == "POSITION")
+      ok = p_reader.read_index(r_primitive.position);
+    else if (name == "NORMAL")
+      ok = p_reader.read_index(r_primitive.normal);
+    else if (name == "TEXCOORD_0")
+      ok = p_reader.read_index(r_primitive.tex_coord);
+    else
+      ok = p_reader.skip_value();
+    if (!ok) return false;
+  }
+  return !p_reader.failed;
+}
+
+static bool parse_mesh(JsonReader& p_reader, std::string_view p_key, GltfMesh& r_mesh)
+{
+  if (p_key != "primitives") return p_reader.skip_value();
+  return parse_array(p_reader, r_mesh.primitives, [&](std::string_view p_primitive_key, GltfPrimitive& r_primitive) { return parse_primitive(p_reader, p_primitive_key, r_primitive); });
+}
+
+static bool parse_node(JsonReader& p_reader, std::string_view p_key, GltfNode& r_node)
+{
+  if (p_key == "mesh") return p_reader.read_index(r_node.mesh);
+  if (p_key == "translation") return p_reader.read_floats(r_node.translation, 3);
+  if (p_key == "rotation") return p_reader.read_floats(r_node.rotation, 4);
+  if (p_key == "scale") return p_reader.read_floats(r_node.scale, 3);
+  if (p_key == "matrix") return r_node.has_matrix = p_reader.read_floats(r_node.matrix, 16);
+  if (p_key != "children") return p_reader.skip_value();
+
+  ArrayBuilder<int32_t> children { p_reader };
+  if (!p_reader.expect('[')) return false;
+  bool first = true;
+  while (p_reader.next_element(first))
+  {
+    if (!p_reader.read_index(*children.push())) return false;
+  }
+  r_node.children = children.finish();
+  return !p_reader.failed;
+}
+
+static bool parse_material(JsonReader& p_reader, std::string_view p_key, GltfMaterial& r_material)
+{
+  if (p_key != "pbrMetallicRoughness") return p_reader.skip_value();
+
+  if (!p_reader.expect('{')) return false;
+  bool first = true;
+  std::string_view key;
+  while (p_reader.next_key(first, key))
+  {
+    bool ok;
+    if (key == "baseColorFactor")
+    {
+      ok = p_reader.read_floats(r_material.base_color_factor, 4);
+    }
+    else if (key == "baseColorTexture")
+    {
+      ok = p_reader.expect('{');
+      bool first_info = true;
+      std::string_view info_key;
+      while (ok && p_reader.next_key(first_info, info_key))
+      {
+        ok = info_key == "index" ? p_reader.read_index(r_material.base_color_texture) : p_reader.skip_value();
+      }
+      ok = ok && !p_reader.failed;
+    }
+    else
+    {
+      ok = p_reader.skip_value();
+    }
+    if (!ok) return false;
+  }
+  return !p_reader.failed;
+}
+
+static bool parse_texture(JsonReader& p_reader, std::string_view p_key, GltfTexture& r_texture)
+{
+  if (p_key == "source") return p_reader.read_index(r_texture.source);
+  return p_reader.skip_value();
+}
+
+static bool parse_image(JsonReader& p_reader, std::string_view p_key, GltfImage& r_image)
+{
+  if (p_key == "uri") return p_reader.read_string(r_image.uri);
+  if (p_key == "mimeType") return p_reader.read_string(r_image.mime_type);
+  if (p_key == "bufferView") return p_reader.read_index(r_image.buffer_view);
+  return p_reader.skip_value();
+}
+
+// Indices are checked once here, so users can index without checks.
+static bool validate(const GltfDocument& p_document)
+{
+  auto in_range = [](int32_t p_index, uint32_t p_count) { return p_index >= -1 && p_index < (int32_t)p_count; };
+
+  for (const GltfBufferView& view : p_document.buffer_views)
+  {
+    if (view.buffer < 0 || !in_range(view.buffer, p_document.buffers.count)) return false;
+  }
+  for (const GltfAccessor& accessor : p_document.accessors)
+  {
+    if (!in_range(accessor.buffer_view, p_document.buffer_views.count) || accessor.components == 0) return false;
+    if (GltfParser::get_component_size(accessor.component_type) == 0) return false;
+  }
+  for (const GltfMesh& mesh : p_document.meshes)
+  {
+    for (const GltfPrimitive& primitive : mesh.primitives)
+    {
+      uint32_t accessors = p_document.accessors.count;
+      if (!in_range(primitive.position, accessors) || !in_range(primitive.normal, accessors) || !in_range(primitive.tex_coord, accessors) || !in_range(primitive.indices, accessors)) return false;
+      if (!in_range(primitive.material, p_document.materials.count)) return false;
+    }
+  }
+  for (const GltfNode& node : p_document.nodes)
+  {
+    if (!in_range(node.mesh, p_document.meshes.count)) return false;
+    for (int32_t child : node.children)
+    {
+      if (!in_range(child, p_document.nodes.count)) return false;
+    }
+  }
+  for (const GltfMaterial& material : p_document.materials)
+  {
+    if (!in_range(material.base_color_texture, p_document.textures.count)) return false;
+  }
+  for (const GltfTexture& texture : p_document.textures)
+  {
+    if (!in_range(texture.source, p_document.images.count)) return false;
+  }
+  for (const GltfImage& image : p_document.images)
+  {
+    if (!in_range(image.buffer_view, p_document.buffer_views.count)) return false;
+  }
+  return true;
+}
+
+bool GltfParser::parse(const char* p_text, size_t p_size, FrameArena& p_arena, GltfDocument& r_document)
+{
+  JsonReader reader { p_text, p_text + p_size, p_arena };
+  r_document = GltfDocument {};
+
+  if (!reader.expect('{')) return false;
+  bool first = true;
+  std::string_view key;
+  while (reader.next_key(first, key))
+  {
+    bool ok;
+    if (key == "buffers")
+      ok = parse_array(reader, r_document.buffers, [&](std::string_view p_key, GltfBuffer& r_buffer) { return parse_buffer(reader, p_key, r_buffer); });
+    else if (key == "bufferViews")
+      ok = parse_array(reader, r_document.buffer_views, [&](std::string_view p_key, GltfBufferView& r_view) { return parse_buffer_view(reader, p_key, r_view); });
+    else if (key == "accessors")
+      ok = parse_array(reader, r_document.accessors, [&](std::string_view p_key, GltfAccessor& r_accessor) { return parse_accessor(reader, p_key, r_accessor); });
+    else if (key == "meshes")
+      ok = parse_array(reader, r_document.meshes, [&](std::string_view p_key, GltfMesh& r_mesh) { return parse_mesh(reader, p_key, r_mesh); });
+    else if (key == "nodes")
+      ok = parse_array(reader, r_document.nodes, [&](std::string_view p_key, GltfNode& r_node) { return parse_node(reader, p_key, r_node); });
+    else if (key == "materials")
+      ok = parse_array(reader, r_document.materials, [&](std::string_view p_key, GltfMaterial& r_material) { return parse_material(reader, p_key, r_material); });
+    else if (key == "textures")
+      ok = parse_array(reader, r_document.textures, [&](std::string_view p_key, GltfTexture& r_texture) { return parse_texture(reader, p_key, r_texture); });
+    else if (key == "images")
+      ok = parse_array(reader, r_document.images, [&](std::string_view p_key, GltfImage& r_image) { return parse_image(reader, p_key, r_image); });
+    else if (key == "scene")
+      ok = reader.read_index(r_document.scene);
+    else
+      ok = reader.skip_value();
+    if (!ok) return false;
+  }
+  if (reader.failed) return false;
+
+  if (reader.peek() != '\0') return reader.fail();
+
+  if (!validate(r_document))
+  {
+    std::cerr << "ERROR::GLTF::INVALID_INDEX" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+uint32_t GltfParser::get_component_size(uint32_t p_component_type)
+{
+  switch (p_component_type)
+  {
+    case 5120: // BYTE
+    case COMPONENT_UNSIGNED_BYTE: return 1;
+    case 5122: // SHORT
+    case COMPONENT_UNSIGNED_SHORT: return 2;
+    case COMPONENT_UNSIGNED_INT:
+    case COMPONENT_FLOAT: return 4;
+    default: return 0;
+  }
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+class FrameArena;
+
+// Span of parsed elements, allocated from the parse arena.
+template <typename T>
+struct GltfArray
+{
+  T* data = nullptr;
+  uint32_t count = 0;
+
+  T& operator[](size_t p_index) { return data[p_index]; }
+  const T& operator[](size_t p_index) const { return data[p_index]; }
+  T* begin() { return data; }
+  T* end() { return data + count; }
+  const T* begin() const { return data; }
+  const T* end() const { return data + count; }
+};
+
+// Only what the engine uses, indices are -1 where the glTF leaves them out.
+struct GltfBuffer
+{
+  std::string_view uri;
+  uint32_t byte_length = 0;
+};
+
+struct GltfBufferView
+{
+  int32_t buffer = -1;
+  uint32_t byte_offset = 0;
+  uint32_t byte_length = 0;
+  uint32_t byte_stride = 0;
+};
+
+struct GltfAccessor
+{
+  int32_t buffer_view = -1;
+  uint32_t byte_offset = 0;
+  uint32_t count = 0;
+  uint32_t component_type = 0;
+  // 1 for SCALAR up to 16 for MAT4.
+  uint32_t components = 0;
+};
+
+struct GltfPrimitive
+{
+  int32_t position = -1;
+  int32_t normal = -1;
+  int32_t tex_coord = -1;
+  int32_t indices = -1;
+  int32_t material = -1;
+  uint32_t mode = 4; // GL_TRIANGLES
+};
+
+struct GltfMesh
+{
+  GltfArray<GltfPrimitive> primitives;
+};
+
+struct GltfNode
+{
+  int32_t mesh = -1;
+  GltfArray<int32_t> children;
+  float translation[3] = { 0.0f, 0.0f, 0.0f };
+  float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+  float scale[3] = { 1.0f, 1.0f, 1.0f };
+  // Column major, only set if has_matrix.
+  float matrix[16] = {};
+  bool has_matrix = false;
+};
+
+struct GltfMaterial
+{
+  int32_t base_color_texture = -1;
+  float base_color_factor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+};
+
+struct GltfTexture
+{
+  int32_t source = -1;
+};
+
+struct GltfImage
+{
+  std::string_view uri;
+  std::string_view mime_type;
+  int32_t buffer_view = -1;
+};
+
+// Parsed glTF JSON. Strings point into the source text, or into the arena
+// when they had escapes, so the document is valid as long as both are.
+struct GltfDocument
+{
+  GltfArray<GltfBuffer> buffers;
+  GltfArray<GltfBufferView> buffer_views;
+  GltfArray<GltfAccessor> accessors;
+  GltfArray<GltfMesh> meshes;
+  GltfArray<GltfNode> nodes;
+  GltfArray<GltfMaterial> materials;
+  GltfArray<GltfTexture> textures;
+  GltfArray<GltfImage> images;
+  int32_t scene = -1;
+};
+
+// Single pass glTF reader. Walks the JSON text once and writes the parts
+// listed above into arena arrays, collected in reused scratch buffers until
+// each array ends; everything else is skipped without being materialized. No
+// DOM, no per-element heap allocations.
+// Buffer and image URIs are left to the caller to resolve.
+class GltfParser
+{
+  public:
+  static constexpr uint32_t COMPONENT_UNSIGNED_BYTE = 5121;
+  static constexpr uint32_t COMPONENT_UNSIGNED_SHORT = 5123;
+  static constexpr uint32_t COMPONENT_UNSIGNED_INT = 5125;
+  static constexpr uint32_t COMPONENT_FLOAT = 5126;
+
+  // False on malformed JSON or out of range indices, errors are logged.
+  static bool parse(const char* p_text, size_t p_size, FrameArena& p_arena, GltfDocument& r_document);
+
+  static uint32_t get_component_size(uint32_t p_component_type);
+};
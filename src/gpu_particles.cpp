@@ -0,0 +1,140 @@
+#include "./gpu_particles.h"
+
+#include "./memory_tracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+void GpuParticles::init(GLStateCache& p_state, uint32_t p_capacity, unsigned int p_update_program, unsigned int p_draw_program)
+{
+  capacity = p_capacity;
+  update_program = p_update_program;
+  draw_program = p_draw_program;
+  u_delta = glGetUniformLocation(update_program, "u_delta");
+  u_gravity = glGetUniformLocation(update_program, "u_gravity");
+  u_drag = glGetUniformLocation(update_program, "u_drag");
+
+  glGenBuffers(2, buffers);
+  glGenVertexArrays(2, update_vaos);
+  glGenVertexArrays(2, draw_vaos);
+
+  for (int i = 0; i < 2; ++i)
+  {
+    p_state.bind_buffer(GL_ARRAY_BUFFER, buffers[i]);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(State), nullptr, GL_DYNAMIC_COPY);
+
+    // Update reads every field.
+    p_state.bind_vertex_array(update_vaos[i]);
+    for (GLuint attribute = 0; attribute < 4; ++attribute)
+    {
+      glEnableVertexAttribArray(attribute);
+      glVertexAttribPointer(attribute, 4, GL_FLOAT, GL_FALSE, sizeof(State), (void*)(attribute * sizeof(glm::vec4)));
+    }
+
+    // Drawing uses the same inputs as the CPU particle path.
+    p_state.bind_vertex_array(draw_vaos[i]);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(State), (void*)offsetof(State, position_size));
+    glVertexAttribDivisor(0, 1);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(State), (void*)offsetof(State, color));
+    glVertexAttribDivisor(1, 1);
+  }
+
+  staging.reserve(4096);
+  MemoryTracker::add_gpu(MEMORY_TAG_RENDER, 2 * capacity * sizeof(State));
+}
+
+void GpuParticles::destroy()
+{
+  glDeleteVertexArrays(2, update_vaos);
+  glDeleteVertexArrays(2, draw_vaos);
+  glDeleteBuffers(2, buffers);
+  MemoryTracker::remove_gpu(MEMORY_TAG_RENDER, 2 * capacity * sizeof(State));
+  active = 0;
+}
+
+float GpuParticles::random()
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return (rng_state >> 8) * (1.0f / 16777216.0f);
+}
+
+void GpuParticles::spawn(GLStateCache& p_state, const ParticleBurst& p_burst)
+{
+  uint32_t count = std::min(p_burst.count, capacity);
+  if (count == 0) return;
+
+  staging.resize(count);
+  for (State& state : staging)
+  {
+    float z = random() * 2.0f - 1.0f;
+    float angle = random() * 6.2831853f;
+    float ring = std::sqrt(1.0f - z * z);
+    float speed = p_burst.speed * (0.5f + random());
+    float lifetime = p_burst.lifetime * (0.75f + 0.5f * random());
+
+    state.position_size = glm::vec4 { p_burst.position, p_burst.size };
+    state.velocity_life = glm::vec4 { ring * std::cos(angle) * speed, ring * std::sin(angle) * speed, z * speed, lifetime };
+    state.color = glm::vec4 { p_burst.color, 1.0f };
+    state.params = glm::vec4 { 1.0f / lifetime, 0.0f, 0.0f, 0.0f };
+  }
+
+  // Written into the buffer the next update reads from, wrapping around.
+  p_state.bind_buffer(GL_ARRAY_BUFFER, buffers[current]);
+  uint32_t first_part = std::min(count, capacity - spawn_cursor);
+  glBufferSubData(GL_ARRAY_BUFFER, spawn_cursor * sizeof(State), first_part * sizeof(State), staging.data());
+  if (first_part < count)
+  {
+    glBufferSubData(GL_ARRAY_BUFFER, 0, (count - first_part) * sizeof(State), staging.data() + first_part);
+  }
+
+  if (spawn_cursor + count > active) active = std::min(capacity, spawn_cursor + count);
+  spawn_cursor = (spawn_cursor + count) % capacity;
+}
+
+void GpuParticles::update(GLStateCache& p_state, float p_delta)
+{
+  if (active == 0) return;
+
+  int next = current ^ 1;
+
+  p_state.use_program(update_program);
+  glUniform1f(u_delta, p_delta);
+  glUniform3f(u_gravity, gravity.x, gravity.y, gravity.z);
+  glUniform1f(u_drag, drag);
+
+  p_state.bind_vertex_array(update_vaos[current]);
+  p_state.bind_buffer_range(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffers[next], 0, capacity * sizeof(State));
+
+  p_state.enable(GL_RASTERIZER_DISCARD);
+  glBeginTransformFeedback(GL_POINTS);
+  glDrawArrays(GL_POINTS, 0, active);
+  p_state.count_draw(0);
+  glEndTransformFeedback();
+  p_state.disable(GL_RASTERIZER_DISCARD);
+
+  // Every active slot was rewritten, slots past active are never read.
+  current = next;
+}
+
+void GpuParticles::draw(GLStateCache& p_state)
+{
+  if (active == 0) return;
+
+  p_state.use_program(draw_program);
+  p_state.bind_vertex_array(draw_vaos[current]);
+
+  p_state.enable(GL_BLEND);
+  p_state.blend_func(GL_SRC_ALPHA, GL_ONE);
+  p_state.depth_mask(false);
+
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, active);
+  p_state.count_draw(2 * active);
+
+  p_state.depth_mask(true);
+  p_state.disable(GL_BLEND);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "./gl_state_cache.h"
+#include "./particle_system.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// GPU-simulated particles. State lives in two VBOs that are ping-ponged with
+// transform feedback every update, so after spawn() uploads the initial state
+// the CPU never sees a particle again. Slots are handed out round robin, a
+// dead particle stays in its slot with zero size until it gets respawned.
+// Render thread only.
+class GpuParticles
+{
+  public:
+  // Layout of one slot, matches particle_update.vert.
+  struct State
+  {
+    glm::vec4 position_size;
+    glm::vec4 velocity_life;
+    glm::vec4 color;
+    glm::vec4 params;
+  };
+
+  void init(GLStateCache& p_state, uint32_t p_capacity, unsigned int p_update_program, unsigned int p_draw_program);
+  void destroy();
+
+  void spawn(GLStateCache& p_state, const ParticleBurst& p_burst);
+  void update(GLStateCache& p_state, float p_delta);
+  void draw(GLStateCache& p_state);
+
+  // Slots that have been used at least once, this is what update and draw
+  // process.
+  uint32_t get_active_count() const { return active; }
+  uint32_t get_capacity() const { return capacity; }
+
+  glm::vec3 gravity { 0.0f, -4.0f, 0.0f };
+  float drag = 0.8f;
+
+  private:
+  float random();
+
+  uint32_t capacity = 0;
+  uint32_t active = 0;
+  uint32_t spawn_cursor = 0;
+  int current = 0;
+
+  GLuint buffers[2] = { 0, 0 };
+  GLuint update_vaos[2] = { 0, 0 };
+  GLuint draw_vaos[2] = { 0, 0 };
+
+  unsigned int update_program = 0;
+  unsigned int draw_program = 0;
+  int u_delta = -1;
+  int u_gravity = -1;
+  int u_drag = -1;
+
+  std::vector<State> staging;
+  uint32_t rng_state = 0x2545F491u;
+};
@@ -0,0 +1,247 @@
+#include "./job_system.h"
+
+#include <chrono>
+
+static thread_local JobSystem* current_system = nullptr;
+static thread_local int current_worker = -1;
+
+bool WorkStealingDeque::push(Job* p_job)
+{
+  int64_t b = bottom.load(std::memory_order_relaxed);
+  int64_t t = top.load(std::memory_order_acquire);
+  if (b - t >= CAPACITY) return false;
+
+  buffer[b & (CAPACITY - 1)].store(p_job, std::memory_order_release);
+  std::atomic_thread_fence(std::memory_order_release);
+  bottom.store(b + 1, std::memory_order_relaxed);
+  return true;
+}
+
+Job* WorkStealingDeque::pop()
+{
+  int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+  bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t t = top.load(std::memory_order_relaxed);
+
+  if (t > b)
+  {
+    // Empty.
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  Job* job = buffer[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+  if (t == b)
+  {
+    // Last item, race against thieves for it.
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+      job = nullptr;
+    }
+    bottom.store(b + 1, std::memory_order_relaxed);
+  }
+  return job;
+}
+
+Job* WorkStealingDeque::steal()
+{
+  int64_t t = top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t b = bottom.load(std::memory_order_acquire);
+  if (t >= b) return nullptr;
+
+  Job* job = buffer[t & (CAPACITY - 1)].load(std::memory_order_acquire);
+  if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+  {
+    return nullptr;
+  }
+  return job;
+}
+
+JobSystem::JobSystem(unsigned int p_thread_count)
+{
+  thread_count = p_thread_count ? p_thread_count : std::thread::hardware_concurrency();
+  thread_count = std::min(std::max(thread_count, 1u), MAX_WORKERS);
+
+  shared_queue.reserve(WorkStealingDeque::CAPACITY);
+  deferred.reserve(WorkStealingDeque::CAPACITY);
+
+  workers = new Worker[thread_count];
+  current_system = this;
+  current_worker = 0;
+  for (unsigned int i = 1; i < thread_count; ++i)
+  {
+    workers[i].thread = std::thread { &JobSystem::worker_main, this, i };
+  }
+}
+
+JobSystem::~JobSystem()
+{
+  running.store(false);
+  {
+    std::lock_guard<std::mutex> lock { sleep_mutex };
+    sleep_condition.notify_all();
+  }
+  for (unsigned int i = 1; i < thread_count; ++i)
+  {
+    workers[i].thread.join();
+  }
+  delete[] workers;
+
+  if (current_system == this)
+  {
+    current_system = nullptr;
+    current_worker = -1;
+  }
+}
+
+void JobSystem::run(Job* p_jobs, size_t p_count, JobCounter* p_counter)
+{
+  if (p_counter) p_counter->value.fetch_add(p_count, std::memory_order_relaxed);
+
+  for (size_t i = 0; i < p_count; ++i)
+  {
+    p_jobs[i].counter = p_counter;
+    push(&p_jobs[i]);
+  }
+
+  if (sleeping.load(std::memory_order_relaxed) > 0)
+  {
+    std::lock_guard<std::mutex> lock { sleep_mutex };
+    sleep_condition.notify_all();
+  }
+}
+
+void JobSystem::wait(const JobCounter* p_counter)
+{
+  int index = current_system == this ? current_worker : -1;
+  while (p_counter->value.load(std::memory_order_acquire) > 0)
+  {
+    if (Job* job = find_job(index))
+    {
+      execute(job);
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void JobSystem::push(Job* p_job)
+{
+  if (p_job->dependency && p_job->dependency->value.load(std::memory_order_acquire) > 0)
+  {
+    std::lock_guard<std::mutex> lock { deferred_mutex };
+    // Announce the job before re-checking. Paired with execute(), which drops
+    // the counter before reading deferred_count (both sequentially
+    // consistent): either it sees this job and flushes under the lock, or
+    // this re-check sees the dependency finished.
+    deferred_count.fetch_add(1, std::memory_order_seq_cst);
+    if (p_job->dependency->value.load(std::memory_order_seq_cst) > 0)
+    {
+      deferred.push_back(p_job);
+      return;
+    }
+    deferred_count.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  if (current_system == this && current_worker >= 0 && workers[current_worker].deque.push(p_job))
+  {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock { shared_mutex };
+  shared_queue.push_back(p_job);
+}
+
+Job* JobSystem::find_job(int p_index)
+{
+  if (p_index >= 0)
+  {
+    if (Job* job = workers[p_index].deque.pop()) return job;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock { shared_mutex };
+    if (!shared_queue.empty())
+    {
+      Job* job = shared_queue.back();
+      shared_queue.pop_back();
+      return job;
+    }
+  }
+
+  // Start at a different victim per thread so thieves spread out.
+  unsigned int start = p_index >= 0 ? p_index + 1 : 0;
+  for (unsigned int i = 0; i < thread_count; ++i)
+  {
+    unsigned int victim = (start + i) % thread_count;
+    if ((int)victim == p_index) continue;
+    if (Job* job = workers[victim].deque.steal()) return job;
+  }
+  return nullptr;
+}
+
+void JobSystem::execute(Job* p_job)
+{
+  p_job->function(p_job->data);
+
+  JobCounter* counter = p_job->counter;
+  if (!counter) return;
+
+  if (counter->value.fetch_sub(1, std::memory_order_seq_cst) == 1 && deferred_count.load(std::memory_order_seq_cst) > 0)
+  {
+    // Something may have been waiting on this counter, release what's ready.
+    std::lock_guard<std::mutex> lock { deferred_mutex };
+    for (size_t i = 0; i < deferred.size();)
+    {
+      Job* job = deferred[i];
+      if (job->dependency->value.load(std::memory_order_acquire) == 0)
+      {
+        deferred[i] = deferred.back();
+        deferred.pop_back();
+        deferred_count.fetch_sub(1, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> shared_lock { shared_mutex };
+        shared_queue.push_back(job);
+      }
+      else
+      {
+        ++i;
+      }
+    }
+  }
+}
+
+void JobSystem::worker_main(unsigned int p_index)
+{
+  current_system = this;
+  current_worker = p_index;
+
+  unsigned int idle_spins = 0;
+  while (running.load(std::memory_order_relaxed))
+  {
+    if (Job* job = find_job(p_index))
+    {
+      execute(job);
+      idle_spins = 0;
+      continue;
+    }
+
+    if (++idle_spins < 64)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    // Nothing to do for a while, sleep until new work shows up. The timeout
+    // covers jobs pushed to another worker's deque without a notify.
+    std::unique_lock<std::mutex> lock { sleep_mutex };
+    sleeping.fetch_add(1, std::memory_order_relaxed);
+    sleep_condition.wait_for(lock, std::chrono::milliseconds { 1 });
+    sleeping.fetch_sub(1, std::memory_order_relaxed);
+    idle_spins = 0;
+  }
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Number of jobs still in flight for a batch. wait() returns once it hits 0.
+struct JobCounter
+{
+  std::atomic<uint32_t> value { 0 };
+};
+
+// Jobs are plain data and never copied or freed by the scheduler, so the
+// array passed to run() must outlive the counter reaching 0.
+struct Job
+{
+  void (*function)(void* p_data) = nullptr;
+  void* data = nullptr;
+  JobCounter* counter = nullptr;
+
+  // Not started before this reaches 0, may be null.
+  const JobCounter* dependency = nullptr;
+};
+
+// Chase-Lev work-stealing deque of job pointers. The owning worker pushes and
+// pops at the bottom, other workers steal from the top.
+class WorkStealingDeque
+{
+  public:
+  static constexpr int64_t CAPACITY = 4096;
+
+  bool push(Job* p_job);
+  Job* pop();
+  Job* steal();
+
+  private:
+  alignas(64) std::atomic<int64_t> top { 0 };
+  alignas(64) std::atomic<int64_t> bottom { 0 };
+  std::atomic<Job*> buffer[CAPACITY];
+};
+
+// Fixed pool of worker threads sized to the machine. The thread constructing
+// the JobSystem counts as worker 0 and participates while it waits. Threads
+// that are not workers can still submit, their jobs go through a shared queue.
+class JobSystem
+{
+  public:
+  static constexpr unsigned int MAX_WORKERS = 64;
+
+  // 0 picks hardware concurrency, including the calling thread.
+  explicit JobSystem(unsigned int p_thread_count = 0);
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  void run(Job* p_jobs, size_t p_count, JobCounter* p_counter);
+  void wait(const JobCounter* p_counter);
+
+  // Calls p_func(begin, end) over [0, p_count) in batches of p_batch_size and
+  // returns when all batches are done. Doesn't allocate.
+  template <typename F>
+  void parallel_for(size_t p_count, size_t p_batch_size, const F& p_func);
+
+  unsigned int get_thread_count() const { return thread_count; }
+
+  private:
+  struct Worker
+  {
+    WorkStealingDeque deque;
+    std::thread thread;
+  };
+
+  void worker_main(unsigned int p_index);
+  Job* find_job(int p_index);
+  void execute(Job* p_job);
+  void push(Job* p_job);
+
+  unsigned int thread_count = 1;
+  Worker* workers = nullptr;
+  std::atomic<bool> running { true };
+
+  // Submissions from threads that are not workers.
+  std::mutex shared_mutex;
+  std::vector<Job*> shared_queue;
+
+  // Jobs waiting on an unfinished dependency.
+  std::mutex deferred_mutex;
+  std::vector<Job*> deferred;
+  std::atomic<uint32_t> deferred_count { 0 };
+
+  std::mutex sleep_mutex;
+  std::condition_variable sleep_condition;
+  std::atomic<uint32_t> sleeping { 0 };
+};
+
+template <typename F>
+void JobSystem::parallel_for(size_t p_count, size_t p_batch_size, const F& p_func)
+{
+  if (p_count == 0) return;
+  p_batch_size = std::max<size_t>(p_batch_size, 1);
+
+  struct Context
+  {
+    const F* func;
+    size_t count;
+    size_t batch_size;
+    std::atomic<size_t> next;
+  };
+  Context context { &p_func, p_count, p_batch_size, { 0 } };
+
+  // One job per thread, each pulls batches until the range is exhausted.
+  auto body = [](void* p_data)
+  {
+    Context* ctx = static_cast<Context*>(p_data);
+    while (true)
+    {
+      size_t begin = ctx->next.fetch_add(ctx->batch_size, std::memory_order_relaxed);
+      if (begin >= ctx->count) break;
+      (*ctx->func)(begin, std::min(begin + ctx->batch_size, ctx->count));
+    }
+  };
+
+  size_t batch_count = (p_count + p_batch_size - 1) / p_batch_size;
+  size_t job_count = std::min<size_t>(batch_count, thread_count);
+
+  Job jobs[MAX_WORKERS];
+  for (size_t i = 0; i < job_count; ++i)
+  {
+    jobs[i].function = body;
+    jobs[i].data = &context;
+  }
+
+  JobCounter counter;
+  run(jobs, job_count, &counter);
+  wait(&counter);
+}
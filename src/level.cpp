@@ -0,0 +1,380 @@
+#include "./level.h"
+
+#include "./asset_pack.h"
+#include "./utils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static const char* POWER_UP_NAMES[POWER_UP_MAX] = { "none", "wide_paddle", "multi_ball", "slow_ball", "extra_life" };
+
+static size_t align4(size_t p_size)
+{
+  return (p_size + 3) & ~(size_t)3;
+}
+
+// Bytes after the header for the given counts.
+static size_t get_body_size(uint32_t p_bricks, uint32_t p_types, uint32_t p_tables, uint32_t p_entries)
+{
+  return 2 * p_bricks * sizeof(float) + 2 * align4(p_bricks) + p_types * sizeof(BrickType) + p_tables * sizeof(PowerUpTable) + p_entries * sizeof(PowerUpEntry);
+}
+
+Level::Level() :
+    x(MAX_BRICKS),
+    y(MAX_BRICKS),
+    types(MAX_BRICKS),
+    hit_points(MAX_BRICKS),
+    brick_types(MAX_TYPES),
+    tables(MAX_TABLES),
+    entries(MAX_ENTRIES)
+{
+}
+
+bool Level::load(const std::string& p_source_path, const std::string& p_cache_dir)
+{
+  namespace fs = std::filesystem;
+  std::error_code error;
+
+  std::string cache_path = get_cache_path(p_source_path, p_cache_dir);
+
+  // Same policy as cooked textures, a cache without its source is trusted.
+  bool stale = fs::exists(p_source_path, error) && fs::exists(cache_path, error)
+      && fs::last_write_time(cache_path, error) < fs::last_write_time(p_source_path, error);
+
+  if (!stale && load_cache(cache_path, AssetPack::hash_path(p_source_path))) return true;
+
+  std::vector<unsigned char> source;
+  if (!Utils::read_file(p_source_path, source))
+  {
+    std::cerr << "ERROR::LEVEL::READ_FAILED " << p_source_path << std::endl;
+    return false;
+  }
+  if (!cook(std::string { source.begin(), source.end() }, p_source_path, file)) return false;
+
+  fs::create_directories(p_cache_dir, error);
+  std::ofstream out { cache_path, std::ios::binary };
+  out.write(reinterpret_cast<const char*>(file.data()), file.size());
+  if (!out.good())
+    std::cerr << "WARNING::LEVEL::CACHE_WRITE_FAILED " << cache_path << std::endl;
+  else
+    std::cerr << "LEVEL::COOKED " << cache_path << std::endl;
+
+  return load_cooked(file.data(), file.size());
+}
+
+std::string Level::get_cache_path(const std::string& p_source_path, const std::string& p_cache_dir)
+{
+  char hash[17];
+  snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)AssetPack::hash_path(p_source_path));
+  return p_cache_dir + "/" + std::filesystem::path { p_source_path }.stem().string() + "-" + hash + ".lvl";
+}
+
+// Checked before load_cooked(), which doesn't know where its data came from.
+static bool is_cooked_from(const unsigned char* p_data, size_t p_size, uint64_t p_source_path_hash)
+{
+  Level::LevelHeader cooked;
+  if (p_size < sizeof(cooked)) return false;
+  std::memcpy(&cooked, p_data, sizeof(cooked));
+  return cooked.source_path_hash == p_source_path_hash;
+}
+
+bool Level::load_cache(const std::string& p_cache_path, uint64_t p_source_path_hash)
+{
+  // Uncompressed pack entries are used where they are mapped, compressed
+  // ones are decoded into the reused file buffer.
+  const AssetPack* pack = AssetPack::get_mounted();
+  const AssetPack::PackEntry* entry = pack != nullptr ? pack->find(p_cache_path) : nullptr;
+  if (entry != nullptr)
+  {
+    if (!(entry->flags & (AssetPack::ENTRY_COMPRESSED | AssetPack::ENTRY_BLOCKED)))
+    {
+      const unsigned char* stored = pack->get_stored(*entry);
+      return is_cooked_from(stored, entry->size, p_source_path_hash) && load_cooked(stored, entry->size);
+    }
+
+    file.resize(entry->size);
+    return pack->read_into(*entry, file.data(), file.size()) && is_cooked_from(file.data(), file.size(), p_source_path_hash) && load_cooked(file.data(), file.size());
+  }
+
+  std::ifstream in { p_cache_path, std::ios::binary | std::ios::ate };
+  if (!in.is_open()) return false;
+  file.resize((size_t)in.tellg());
+  in.seekg(0);
+  in.read(reinterpret_cast<char*>(file.data()), file.size());
+  return in.good() && is_cooked_from(file.data(), file.size(), p_source_path_hash) && load_cooked(file.data(), file.size());
+}
+
+bool Level::load_cooked(const unsigned char* p_data, size_t p_size)
+{
+  LevelHeader cooked;
+  if (p_size < sizeof(cooked)) return false;
+  std::memcpy(&cooked, p_data, sizeof(cooked));
+  if (cooked.magic != MAGIC || cooked.version != VERSION) return false;
+  if (cooked.brick_count > MAX_BRICKS || cooked.type_count > MAX_TYPES || cooked.table_count > MAX_TABLES || cooked.entry_count > MAX_ENTRIES) return false;
+  if (p_size != sizeof(cooked) + get_body_size(cooked.brick_count, cooked.type_count, cooked.table_count, cooked.entry_count)) return false;
+
+  // Validate in place first, so a bad file leaves the current level intact.
+  uint32_t count = cooked.brick_count;
+  const unsigned char* read = p_data + sizeof(cooked);
+  const unsigned char* cooked_x = read;
+  const unsigned char* cooked_y = cooked_x + count * sizeof(float);
+  const unsigned char* cooked_types = cooked_y + count * sizeof(float);
+  const unsigned char* cooked_hit_points = cooked_types + align4(count);
+  const unsigned char* cooked_brick_types = cooked_hit_points + align4(count);
+  const unsigned char* cooked_tables = cooked_brick_types + cooked.type_count * sizeof(BrickType);
+  const unsigned char* cooked_entries = cooked_tables + cooked.table_count * sizeof(PowerUpTable);
+
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    if (cooked_types[i] >= cooked.type_count) return false;
+  }
+  for (uint32_t i = 0; i < cooked.type_count; ++i)
+  {
+    BrickType type;
+    std::memcpy(&type, cooked_brick_types + i * sizeof(BrickType), sizeof(type));
+    if (type.power_up_table != NO_TABLE && type.power_up_table >= cooked.table_count) return false;
+  }
+  for (uint32_t i = 0; i < cooked.table_count; ++i)
+  {
+    PowerUpTable table;
+    std::memcpy(&table, cooked_tables + i * sizeof(PowerUpTable), sizeof(table));
+    if (table.entry_count == 0 || table.total_weight == 0 || table.first_entry + table.entry_count > cooked.entry_count) return false;
+  }
+
+  header = cooked;
+  header.name[sizeof(header.name) - 1] = '\0';
+  std::memcpy(x.data(), cooked_x, count * sizeof(float));
+  std::memcpy(y.data(), cooked_y, count * sizeof(float));
+  std::memcpy(types.data(), cooked_types, count);
+  std::memcpy(hit_points.data(), cooked_hit_points, count);
+  std::memcpy(brick_types.data(), cooked_brick_types, cooked.type_count * sizeof(BrickType));
+  std::memcpy(tables.data(), cooked_tables, cooked.table_count * sizeof(PowerUpTable));
+  std::memcpy(entries.data(), cooked_entries, cooked.entry_count * sizeof(PowerUpEntry));
+
+  remaining = 0;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    if (hit_points[i] > 0 && brick_types[types[i]].hit_points > 0) remaining++;
+  }
+  return true;
+}
+
+bool Level::cook(const std::string& p_source, const std::string& p_path, std::vector<unsigned char>& r_cooked)
+{
+  LevelHeader cooked {};
+  cooked.magic = MAGIC;
+  cooked.version = VERSION;
+  cooked.source_path_hash = AssetPack::hash_path(p_path);
+  float spacing_x = 0.0f;
+  float spacing_y = 0.0f;
+  float origin_x = 0.0f;
+  float origin_y = 0.0f;
+
+  std::vector<std::string> table_names;
+  std::vector<PowerUpTable> cooked_tables;
+  std::vector<PowerUpEntry> cooked_entries;
+  std::string type_keys;
+  std::vector<BrickType> cooked_types;
+  std::vector<std::string> grid;
+  bool in_grid = false;
+  int grid_line = 0;
+
+  std::istringstream lines { p_source };
+  std::string line;
+  int line_number = 0;
+  auto error = [&](const char* p_message)
+  {
+    std::cerr << "ERROR::LEVEL::PARSE " << p_path << ":" << line_number << " " << p_message << std::endl;
+    return false;
+  };
+
+  while (std::getline(lines, line))
+  {
+    line_number++;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (in_grid)
+    {
+      grid.push_back(line);
+      continue;
+    }
+
+    std::istringstream words { line };
+    std::string keyword;
+    if (!(words >> keyword) || keyword[0] == '#') continue;
+
+    if (keyword == "name")
+    {
+      std::string name;
+      std::getline(words >> std::ws, name);
+      std::strncpy(cooked.name, name.c_str(), sizeof(cooked.name) - 1);
+    }
+    else if (keyword == "brick")
+    {
+      if (!(words >> cooked.brick_width >> cooked.brick_height)) return error("expected: brick <width> <height>");
+    }
+    else if (keyword == "spacing")
+    {
+      if (!(words >> spacing_x >> spacing_y)) return error("expected: spacing <x> <y>");
+    }
+    else if (keyword == "origin")
+    {
+      if (!(words >> origin_x >> origin_y)) return error("expected: origin <x> <y>");
+    }
+    else if (keyword == "power_ups")
+    {
+      std::string name;
+      if (!(words >> name)) return error("expected: power_ups <table> (<power_up> <weight>)...");
+      if (cooked_tables.size() == MAX_TABLES) return error("too many power-up tables");
+
+      PowerUpTable table { (uint16_t)cooked_entries.size(), 0, 0 };
+      std::string power_up;
+      uint32_t weight;
+      while (words >> power_up >> weight)
+      {
+        int index = 0;
+        while (index < POWER_UP_MAX && power_up != POWER_UP_NAMES[index]) index++;
+        if (index == POWER_UP_MAX) return error("unknown power-up");
+        if (cooked_entries.size() == MAX_ENTRIES) return error("too many power-up entries");
+        if (weight == 0 || weight > UINT16_MAX) return error("weight out of range");
+
+        cooked_entries.push_back({ (uint8_t)index, 0, (uint16_t)weight });
+        table.entry_count++;
+        table.total_weight += weight;
+      }
+      if (table.entry_count == 0) return error("empty power-up table");
+      table_names.push_back(name);
+      cooked_tables.push_back(table);
+    }
+    else if (keyword == "type")
+    {
+      char key;
+      int points;
+      BrickType type {};
+      std::string table;
+      if (!(words >> key >> points >> type.color[0] >> type.color[1] >> type.color[2] >> table)) return error("expected: type <char> <hit points> <r> <g> <b> <power-up table or ->");
+      if (key == '.' || type_keys.find(key) != std::string::npos) return error("duplicate or reserved type character");
+      if (points < 0 || points > 255) return error("hit points out of range");
+      if (cooked_types.size() == MAX_TYPES) return error("too many brick types");
+
+      type.color[3] = 1.0f;
+      type.hit_points = (uint8_t)points;
+      type.power_up_table = NO_TABLE;
+      if (table != "-")
+      {
+        size_t index = 0;
+        while (index < table_names.size() && table_names[index] != table) index++;
+        if (index == table_names.size()) return error("unknown power-up table, declare it before the type");
+        type.power_up_table = (uint8_t)index;
+      }
+      type_keys += key;
+      cooked_types.push_back(type);
+    }
+    else if (keyword == "grid")
+    {
+      in_grid = true;
+      grid_line = line_number;
+    }
+    else
+    {
+      return error("unknown keyword");
+    }
+  }
+
+  if (cooked.brick_width <= 0.0f || cooked.brick_height <= 0.0f) return error("missing brick size");
+  while (!grid.empty() && grid.back().find_first_not_of(" ") == std::string::npos) grid.pop_back();
+  if (grid.empty()) return error("missing grid");
+
+  // Row by row from the top, '.' and ' ' are empty cells.
+  std::vector<float> cooked_x;
+  std::vector<float> cooked_y;
+  std::vector<uint8_t> cooked_brick_types;
+  std::vector<uint8_t> cooked_hit_points;
+  size_t columns = 0;
+  for (size_t row = 0; row < grid.size(); ++row)
+  {
+    columns = std::max(columns, grid[row].size());
+    for (size_t column = 0; column < grid[row].size(); ++column)
+    {
+      char key = grid[row][column];
+      if (key == '.' || key == ' ') continue;
+      size_t type = type_keys.find(key);
+      if (type == std::string::npos)
+      {
+        line_number = grid_line + (int)row + 1;
+        return error("unknown brick type in grid");
+      }
+      if (cooked_x.size() == MAX_BRICKS) return error("too many bricks");
+
+      cooked_x.push_back(origin_x + column * spacing_x);
+      cooked_y.push_back(origin_y - row * spacing_y);
+      cooked_brick_types.push_back((uint8_t)type);
+      // Indestructible bricks get one that is never taken.
+      cooked_hit_points.push_back(std::max<uint8_t>(cooked_types[type].hit_points, 1));
+    }
+  }
+  if (columns > UINT16_MAX || grid.size() > UINT16_MAX) return error("grid too large");
+
+  cooked.brick_count = (uint32_t)cooked_x.size();
+  cooked.columns = (uint16_t)columns;
+  cooked.rows = (uint16_t)grid.size();
+  cooked.type_count = (uint32_t)cooked_types.size();
+  cooked.table_count = (uint32_t)cooked_tables.size();
+  cooked.entry_count = (uint32_t)cooked_entries.size();
+  if (cooked.name[0] == '\0') std::strncpy(cooked.name, std::filesystem::path { p_path }.stem().string().c_str(), sizeof(cooked.name) - 1);
+
+  uint32_t count = cooked.brick_count;
+  r_cooked.assign(sizeof(cooked) + get_body_size(count, cooked.type_count, cooked.table_count, cooked.entry_count), 0);
+  unsigned char* write = r_cooked.data();
+  auto append = [&](const void* p_source_data, size_t p_size, size_t p_padded_size)
+  {
+    if (p_size > 0) std::memcpy(write, p_source_data, p_size);
+    write += p_padded_size;
+  };
+  append(&cooked, sizeof(cooked), sizeof(cooked));
+  append(cooked_x.data(), count * sizeof(float), count * sizeof(float));
+  append(cooked_y.data(), count * sizeof(float), count * sizeof(float));
+  append(cooked_brick_types.data(), count, align4(count));
+  append(cooked_hit_points.data(), count, align4(count));
+  append(cooked_types.data(), cooked_types.size() * sizeof(BrickType), cooked_types.size() * sizeof(BrickType));
+  append(cooked_tables.data(), cooked_tables.size() * sizeof(PowerUpTable), cooked_tables.size() * sizeof(PowerUpTable));
+  append(cooked_entries.data(), cooked_entries.size() * sizeof(PowerUpEntry), cooked_entries.size() * sizeof(PowerUpEntry));
+  return true;
+}
+
+bool Level::is_alive(uint32_t p_brick) const
+{
+  return hit_points[p_brick] > 0;
+}
+
+bool Level::hit(uint32_t p_brick)
+{
+  if (!is_alive(p_brick) || get_type(p_brick).hit_points == 0) return false;
+  if (--hit_points[p_brick] > 0) return false;
+  remaining--;
+  return true;
+}
+
+PowerUp Level::roll_power_up(uint32_t p_brick, uint32_t p_random) const
+{
+  uint8_t table_index = get_type(p_brick).power_up_table;
+  if (table_index == NO_TABLE) return POWER_UP_NONE;
+
+  const PowerUpTable& table = tables[table_index];
+  uint32_t roll = p_random % table.total_weight;
+  for (uint32_t i = table.first_entry; i < table.first_entry + table.entry_count; ++i)
+  {
+    if (roll < entries[i].weight) return (PowerUp)entries[i].power_up;
+    roll -= entries[i].weight;
+  }
+  return POWER_UP_NONE;
+}
+
+const char* Level::get_power_up_name(PowerUp p_power_up)
+{
+  return p_power_up < POWER_UP_MAX ? POWER_UP_NAMES[p_power_up] : "unknown";
+}
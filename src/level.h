@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum PowerUp : uint8_t
+{
+  POWER_UP_NONE,
+  POWER_UP_WIDE_PADDLE,
+  POWER_UP_MULTI_BALL,
+  POWER_UP_SLOW_BALL,
+  POWER_UP_EXTRA_LIFE,
+  POWER_UP_MAX
+};
+
+struct BrickType
+{
+  float color[4];
+  // 0 for bricks that can't be destroyed.
+  uint8_t hit_points;
+  // Table rolled when the brick is destroyed, NO_TABLE for none.
+  uint8_t power_up_table;
+  uint8_t pad[2];
+};
+
+// Weighted drops, entries [first_entry, first_entry + entry_count) of the
+// level's entry list.
+struct PowerUpTable
+{
+  uint16_t first_entry;
+  uint16_t entry_count;
+  uint32_t total_weight;
+};
+
+struct PowerUpEntry
+{
+  uint8_t power_up;
+  uint8_t pad;
+  uint16_t weight;
+};
+
+// A breakout level: brick grid, brick types and power-up tables.
+//
+// Levels are written as text (res/levels/*.txt, see level_01.txt for the
+// syntax) and cooked into a binary form on first load, cached next to the
+// cooked textures. The cooked file is the in-memory layout: one read into a
+// reused buffer (or, for an uncompressed asset pack entry, a pointer into the
+// mapped pack) and a memcpy per array into the brick arrays, which are
+// allocated once at MAX_BRICKS, so switching levels does no per-brick work or
+// allocation.
+//
+// Cooked layout: LevelHeader, then x[brick_count], y[brick_count],
+// type[brick_count] and hit_points[brick_count] (byte arrays padded to 4),
+// BrickType[type_count], PowerUpTable[table_count] and
+// PowerUpEntry[entry_count].
+class Level
+{
+  public:
+  static constexpr uint32_t MAGIC = 0x4C564C42; // "BLVL"
+  static constexpr uint32_t VERSION = 2;
+  static constexpr uint32_t MAX_BRICKS = 2048;
+  static constexpr uint32_t MAX_TYPES = 64;
+  static constexpr uint32_t MAX_TABLES = 16;
+  static constexpr uint32_t MAX_ENTRIES = 128;
+  static constexpr uint8_t NO_TABLE = 0xFF;
+
+  struct LevelHeader
+  {
+    uint32_t magic;
+    uint32_t version;
+    // AssetPack::hash_path() of the source, a cache cooked from another file
+    // is rejected.
+    uint64_t source_path_hash;
+    uint32_t brick_count;
+    uint16_t columns;
+    uint16_t rows;
+    uint32_t type_count;
+    uint32_t table_count;
+    uint32_t entry_count;
+    float brick_width;
+    float brick_height;
+    char name[32];
+  };
+
+  Level();
+
+  // Cooked level for the source at p_source_path, from p_cache_dir unless
+  // the cache is missing or older than the source. The current level is kept
+  // if this fails, errors are logged.
+  bool load(const std::string& p_source_path, const std::string& p_cache_dir);
+
+  // Replaces the current level with a cooked one. False if it is malformed.
+  bool load_cooked(const unsigned char* p_data, size_t p_size);
+
+  // Cache files are named after the full source path, so equally named
+  // levels in different directories don't collide.
+  static std::string get_cache_path(const std::string& p_source_path, const std::string& p_cache_dir);
+
+  // Text source to the cooked form, p_path is hashed into the header and
+  // used in errors.
+  static bool cook(const std::string& p_source, const std::string& p_path, std::vector<unsigned char>& r_cooked);
+
+  // Takes a hit point from a brick. True if that destroyed it.
+  bool hit(uint32_t p_brick);
+
+  // Drop for a destroyed brick, p_random is any uniformly distributed value.
+  PowerUp roll_power_up(uint32_t p_brick, uint32_t p_random) const;
+
+  static const char* get_power_up_name(PowerUp p_power_up);
+
+  const char* get_name() const { return header.name; }
+  uint32_t get_brick_count() const { return header.brick_count; }
+  float get_brick_width() const { return header.brick_width; }
+  float get_brick_height() const { return header.brick_height; }
+
+  // Brick centers and state, get_brick_count() long. Destroyed bricks keep
+  // their slot with 0 hit points.
+  const float* get_x() const { return x.data(); }
+  const float* get_y() const { return y.data(); }
+  const uint8_t* get_types() const { return types.data(); }
+  const uint8_t* get_hit_points() const { return hit_points.data(); }
+
+  bool is_alive(uint32_t p_brick) const;
+  const BrickType& get_type(uint32_t p_brick) const { return brick_types[types[p_brick]]; }
+
+  // Destructible bricks left, the level is cleared at 0.
+  uint32_t get_remaining() const { return remaining; }
+
+  private:
+  // Cooked file from the mounted pack or disk into the current level.
+  bool load_cache(const std::string& p_cache_path, uint64_t p_source_path_hash);
+
+  LevelHeader header {};
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<uint8_t> types;
+  std::vector<uint8_t> hit_points;
+  std::vector<BrickType> brick_types;
+  std::vector<PowerUpTable> tables;
+  std::vector<PowerUpEntry> entries;
+  uint32_t remaining = 0;
+
+  // Cooked file buffer, reused across loads.
+  std::vector<unsigned char> file;
+};
@@ -1,141 +1,64 @@
 #include "glm/common.hpp"
 #include "glm/ext/matrix_clip_space.hpp"
 #include "glm/trigonometric.hpp"
+#include "asset_pack.h"
+#include "bvh.h"
+#include "culling.h"
+#include "frame_arena.h"
+#include "geometry_pool.h"
+#include "gl_state_cache.h"
+#include "gpu_particles.h"
+#include "job_system.h"
+#include "level.h"
+#include "memory_tracker.h"
+#include "mesh_loader.h"
+#include "perf_hud.h"
+#include "render_thread.h"
+#include "resource_manager.h"
+#include "shader.h"
+#include "texture_streamer.h"
+#include "transform_hierarchy.h"
+#include "uniform_buffers.h"
 #include "utils.h"
 
 #include <GL/glew.h>
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_main.h>
 #include <cstddef>
+#include <cstring>
 #include <glm/glm.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
+#include <random>
 #include <string>
 #include <vector>
 
-#define TINYGLTF_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "tiny_gltf.h"
-
-using namespace tinygltf;
-
 #define SCREEN_WIDTH 640.0f
 #define SCREEN_HEIGHT 480.0f
+#define Z_NEAR 0.1f
+#define Z_FAR 100.0f
 #define TIME_SEC (float)SDL_GetTicks() / 1000.0f
 
-// TODO: Make this not global
-unsigned int texture_id;
-
-// TODO: Create Vertex struct and use glm vectors
-struct MeshData
-{
-  std::vector<float> positions;
-  std::vector<float> tex_coords;
-  std::vector<uint32_t> indices;
-};
-
-enum VBO
-{
-  VBO_POSITION,
-  VBO_TEX_COORD,
-  VBO_MAX
-};
-
-// TODO: Update variables to const refs where applicable
-MeshData load_mesh_data(const std::string& filepath)
-{
-  Model model;
-  TinyGLTF loader;
-  std::string err;
-  std::string warn;
-
-  bool ret = loader.LoadASCIIFromFile(&model, &err, &warn, filepath);
-
-  if (!warn.empty()) std::cerr << "Warning: " << warn << std::endl;
-  if (!err.empty()) std::cerr << "Error: " << err << std::endl;
-  if (!ret)
-  {
-    std::cerr << "Failed to load glTF!" << std::endl;
-    return MeshData {};
-  }
-
-  // Assuming mesh 0, primitive 0, one material.
-  Primitive primitive = model.meshes[0].primitives[0];
-  Material material = model.materials[primitive.material];
-  Texture texture = model.textures[material.pbrMetallicRoughness.baseColorTexture.index];
-  Image image = model.images[texture.source];
-
-  // Position
-  Accessor pos_accessor = model.accessors[primitive.attributes.at("POSITION")];
-  BufferView pos_buffer_view = model.bufferViews[pos_accessor.bufferView];
-  Buffer pos_buffer = model.buffers[pos_buffer_view.buffer];
-  const unsigned char* pos_data = pos_buffer.data.data() + pos_buffer_view.byteOffset + pos_accessor.byteOffset;
-  std::vector<float> positions(pos_accessor.count * 3);
-  memcpy(positions.data(), pos_data, pos_accessor.count * 3 * sizeof(float));
-
-  // Tex Coord
-  Accessor tc_accessor = model.accessors[primitive.attributes.at("TEXCOORD_0")];
-  BufferView tc_buffer_view = model.bufferViews[tc_accessor.bufferView];
-  Buffer tc_buffer = model.buffers[tc_buffer_view.buffer];
-  const unsigned char* tc_data = tc_buffer.data.data() + tc_buffer_view.byteOffset + tc_accessor.byteOffset;
-  std::vector<float> tex_coords(tc_accessor.count * 2);
-  memcpy(tex_coords.data(), tc_data, tc_accessor.count * 2 * sizeof(float));
-
-  // Indices
-  Accessor idx_accessor = model.accessors[primitive.indices];
-  BufferView idx_buffer_view = model.bufferViews[idx_accessor.bufferView];
-  Buffer idx_buffer = model.buffers[idx_buffer_view.buffer];
-  const unsigned char* idx_data = idx_buffer.data.data() + idx_buffer_view.byteOffset + idx_accessor.byteOffset;
-  std::vector<uint32_t> indices(idx_accessor.count);
-  if (idx_accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-  {
-    const uint16_t* src = reinterpret_cast<const uint16_t*>(idx_data);
-    for (size_t i = 0; i < indices.size(); ++i) indices[i] = src[i];
-  }
-  else if (idx_accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
-  {
-    const uint32_t* src = reinterpret_cast<const uint32_t*>(idx_data);
-    for (size_t i = 0; i < indices.size(); ++i) indices[i] = src[i];
-  }
-  else
-  {
-    std::cerr << "Unsupported glTF index type!" << std::endl;
-  }
-
-  glGenTextures(1, &texture_id);
-  glBindTexture(GL_TEXTURE_2D, texture_id);
-
-  GLenum format = GL_RGB;
-  if (image.component == 1)
-    format = GL_RED;
-  else if (image.component == 3)
-    format = GL_RGB;
-  else if (image.component == 4)
-    format = GL_RGBA;
-
-  glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.image.data());
-
-  glGenerateMipmap(GL_TEXTURE_2D);
-
-  // Set texture parameters
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-  return { positions, tex_coords, indices };
-}
-
 int main(int argc, char* argv[])
 {
   SDL_Window* window;
   bool done = false;
 
+  // Simulate debris on the GPU with transform feedback instead of the CPU.
+  bool use_gpu_particles = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--gpu-particles") == 0) use_gpu_particles = true;
+  }
+
   SDL_Init(SDL_INIT_VIDEO);
 
+  // Shared by asset import, culling, collision and particles. The main thread
+  // is worker 0 and helps out whenever it waits on a job counter.
+  JobSystem job_system;
+
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
@@ -164,94 +87,240 @@ int main(int argc, char* argv[])
     return 1;
   }
 
-  MeshData mesh_data = load_mesh_data("../res/models/pyramid/pyramid.gltf");
-
-  unsigned int vao;
-  glGenVertexArrays(1, &vao);
-  glBindVertexArray(vao);
-
-  unsigned int vbo[VBO_MAX];
-  glGenBuffers(VBO_MAX, &vbo[0]);
-
-  // TODO: Use offsetof function when Vertex struct is implemented
-  glBindBuffer(GL_ARRAY_BUFFER, vbo[VBO_POSITION]);
-  glBufferData(GL_ARRAY_BUFFER, mesh_data.positions.size() * sizeof(float), mesh_data.positions.data(), GL_STATIC_DRAW);
-  glVertexAttribPointer(VBO_POSITION, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-  glEnableVertexAttribArray(VBO_POSITION);
-
-  glBindBuffer(GL_ARRAY_BUFFER, vbo[VBO_TEX_COORD]);
-  glBufferData(GL_ARRAY_BUFFER, mesh_data.tex_coords.size() * sizeof(float), mesh_data.tex_coords.data(), GL_STATIC_DRAW);
-  glVertexAttribPointer(VBO_TEX_COORD, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-  glEnableVertexAttribArray(VBO_TEX_COORD);
-
-  unsigned int ebo;
-  glGenBuffers(1, &ebo);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh_data.indices.size() * sizeof(uint32_t), mesh_data.indices.data(), GL_STATIC_DRAW);
-
-  int success;
-  char info_log[512];
-
-  unsigned int vert_shader;
-  std::string vert_string = Utils::load_file_source("../res/shaders/default.vert");
-  const char* vert_src = vert_string.c_str();
-  vert_shader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vert_shader, 1, &vert_src, nullptr);
-  glCompileShader(vert_shader);
-  glGetShaderiv(vert_shader, GL_COMPILE_STATUS, &success);
-  if (!success)
-  {
-    glGetShaderInfoLog(vert_shader, 512, nullptr, info_log);
-    std::cerr << "ERROR::SHADER::VERTEX::COMPILATION_FAILED" << std::endl;
-    std::cerr << info_log << std::endl;
-  }
+  // Budgets for a small VM, CPU and estimated GPU bytes together. The
+  // texture streamer keeps its own budget inside the assets one.
+  MemoryTracker::set_budget(MEMORY_TAG_ASSETS, 256 << 20);
+  MemoryTracker::set_budget(MEMORY_TAG_RENDER, 128 << 20);
+  MemoryTracker::set_budget(MEMORY_TAG_GAMEPLAY, 32 << 20);
 
-  unsigned int frag_shader;
-  std::string frag_string = Utils::load_file_source("../res/shaders/default.frag");
-  const char* frag_src = frag_string.c_str();
-  frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(frag_shader, 1, &frag_src, nullptr);
-  glCompileShader(frag_shader);
-  glGetShaderiv(frag_shader, GL_COMPILE_STATUS, &success);
-  if (!success)
+  // One mapped file instead of opening every asset, see `make pack`.
+  AssetPack asset_pack;
+  if (asset_pack.open("assets.pak"))
   {
-    glGetShaderInfoLog(frag_shader, 512, nullptr, info_log);
-    std::cerr << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED" << std::endl;
-    std::cerr << info_log << std::endl;
+    asset_pack.set_job_system(&job_system);
+    AssetPack::mount(&asset_pack);
   }
 
-  unsigned int shader_program;
-  shader_program = glCreateProgram();
-  glAttachShader(shader_program, vert_shader);
-  glAttachShader(shader_program, frag_shader);
-  glLinkProgram(shader_program);
-  glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
-  if (!success)
-  {
-    glGetProgramInfoLog(shader_program, 512, nullptr, info_log);
-    std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED" << std::endl;
-    std::cerr << info_log << std::endl;
-  }
+  GLStateCache gl_state;
+
+  // All static meshes share one VAO, draws select theirs by offset.
+  GeometryPool geometry_pool;
+  geometry_pool.init(gl_state, 1 << 18, 1 << 20);
 
+  // Low mips now, the rest as the texture gets close enough to need them.
+  TextureStreamer texture_streamer;
+  texture_streamer.init(gl_state, 64 << 20);
+
+  ResourceManager resources { geometry_pool, texture_streamer };
+  MeshHandle pyramid_handle = resources.load_mesh(gl_state, "../res/models/pyramid/pyramid.gltf");
+  ProgramHandle default_program_handle = resources.load_program("../res/shaders/default.vert", "../res/shaders/default.frag");
+  MeshResource pyramid;
+  TextureResource pyramid_texture;
+  ProgramResource default_program_resource;
+  if (!resources.get(pyramid_handle, pyramid) || !resources.get(default_program_handle, default_program_resource)) return 1;
+  resources.get(pyramid.texture, pyramid_texture);
+
+  unsigned int shader_program = default_program_resource.program;
   glUseProgram(shader_program);
-  glDeleteShader(vert_shader);
-  glDeleteShader(frag_shader);
+
+  ProgramResource particle_program_resource;
+  resources.get(resources.load_program("../res/shaders/particle.vert", "../res/shaders/particle.frag"), particle_program_resource);
+  unsigned int particle_program = particle_program_resource.program;
+  UniformBuffers::bind_program_blocks(particle_program);
+
+  const char* particle_varyings[] = { "o_position_size", "o_velocity_life", "o_color", "o_params" };
+  unsigned int particle_update_program = Shader::load_feedback_program("../res/shaders/particle_update.vert", particle_varyings, 4);
 
   glm::mat4 view { 1.0f };
   view = glm::translate(view, glm::vec3 { 0.0f, 0.0f, -4.0f });
-  int u_view = glGetUniformLocation(shader_program, "u_view");
-  glUniformMatrix4fv(u_view, 1, false, glm::value_ptr(view));
 
-  glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
-  int u_projection = glGetUniformLocation(shader_program, "u_projection");
-  glUniformMatrix4fv(u_projection, 1, false, glm::value_ptr(projection));
+  glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, Z_NEAR, Z_FAR);
+
+  // Ids into these tables are what gameplay puts in draw packet sort keys.
+  RenderResources render_resources;
+
+  UniformBuffers::bind_program_blocks(shader_program);
+  glUniform1i(glGetUniformLocation(shader_program, "u_texture"), 0);
+
+  ShaderProgram default_program;
+  default_program.id = shader_program;
+  render_resources.programs.push_back(default_program);
+
+  render_resources.materials.push_back({ pyramid_texture.texture });
+  render_resources.meshes.push_back({ geometry_pool.get_vao(), pyramid.geometry });
+
+  // One unit box for every brick, scaled to the level's brick size by its
+  // model matrix. Mesh id 1.
+  MeshData brick_mesh = MeshLoader::make_box(glm::vec3 { 0.5f });
+  GeometryRange brick_geometry = geometry_pool.add(gl_state, brick_mesh.positions.data(), brick_mesh.tex_coords.data(), (uint32_t)(brick_mesh.positions.size() / 3), brick_mesh.indices.data(), (uint32_t)brick_mesh.indices.size());
+  render_resources.meshes.push_back({ geometry_pool.get_vao(), brick_geometry });
+
+  // Everything the main thread allocates from here until the game loop is
+  // renderer state.
+  MemoryTracker::set_thread_tag(MEMORY_TAG_RENDER);
+  UniformBuffers uniform_buffers;
+  uniform_buffers.init(gl_state);
+  ParticleRenderer particle_renderer;
+  particle_renderer.init(gl_state, particle_program);
+  GpuParticles gpu_particles;
+  gpu_particles.init(gl_state, 262144, particle_update_program, particle_program);
+
+  // F3 toggles, see PerfHud.
+  ProgramResource hud_program_resource;
+  resources.get(resources.load_program("../res/shaders/hud.vert", "../res/shaders/hud.frag"), hud_program_resource);
+  unsigned int hud_program = hud_program_resource.program;
+  PerfHud perf_hud;
+  perf_hud.init(gl_state, hud_program, SCREEN_WIDTH, SCREEN_HEIGHT);
+  GpuTimer gpu_timer;
+  gpu_timer.init();
+
+  // GL is only touched from the render thread from here on.
+  SDL_GL_MakeCurrent(window, nullptr);
+
+  RenderThread render_thread;
+  render_thread.start(window, opengl_context, [&](const RenderSnapshot& p_snapshot)
+  {
+    uint64_t render_start = SDL_GetTicksNS();
+    gl_state.begin_frame();
+    gpu_timer.begin();
+
+    gl_state.enable(GL_DEPTH_TEST);
+    gl_state.clear_color(0.3f, 0.1f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    gl_state.disable(GL_CULL_FACE);
+
+    FrameUniforms frame_uniforms;
+    frame_uniforms.view = p_snapshot.view;
+    frame_uniforms.projection = p_snapshot.projection;
+    frame_uniforms.time = p_snapshot.time;
+    uniform_buffers.upload(gl_state, frame_uniforms, p_snapshot.objects, p_snapshot.object_count);
+
+    for (size_t i = 0; i < p_snapshot.texture_request_count; ++i)
+    {
+      texture_streamer.request(p_snapshot.texture_requests[i].texture, p_snapshot.texture_requests[i].screen_size);
+    }
+    texture_streamer.update(gl_state);
+
+    RenderQueue::execute(gl_state, uniform_buffers, p_snapshot.packets, p_snapshot.packet_count, render_resources);
+
+    particle_renderer.draw(gl_state, p_snapshot.particles, p_snapshot.particle_count);
+
+    for (size_t i = 0; i < p_snapshot.gpu_burst_count; ++i)
+    {
+      gpu_particles.spawn(gl_state, p_snapshot.gpu_bursts[i]);
+    }
+    gpu_particles.update(gl_state, p_snapshot.delta);
+    gpu_particles.draw(gl_state);
+    gpu_timer.end();
+
+    // Draw and state counts are from the previous frame, this one's aren't
+    // complete until the HUD itself is drawn.
+    PerfHudStats hud_stats;
+    hud_stats.frame_ms = p_snapshot.frame_ms;
+    hud_stats.simulation_ms = p_snapshot.simulation_ms;
+    hud_stats.render_ms = (SDL_GetTicksNS() - render_start) / 1e6f;
+    hud_stats.gpu_ms = gpu_timer.get_ms();
+    hud_stats.draw_calls = gl_state.get_draws_last_frame();
+    hud_stats.triangles = gl_state.get_triangles_last_frame();
+    hud_stats.state_changes = gl_state.get_issued_last_frame();
+    hud_stats.state_changes_skipped = gl_state.get_saved_last_frame();
+    perf_hud.record(hud_stats);
+    if (p_snapshot.show_perf_hud) perf_hud.draw(gl_state);
+
+    uniform_buffers.end_frame();
+    particle_renderer.end_frame();
+    perf_hud.end_frame();
+    resources.collect(gl_state);
+  });
+
+  // The main thread runs gameplay from here on, asset loads retag
+  // themselves.
+  MemoryTracker::set_thread_tag(MEMORY_TAG_GAMEPLAY);
+
+  Frustum frustum = Frustum::from_matrix(projection * view);
 
   glm::vec3 paddle_pos = glm::vec3 { 0.0f, -0.75f, 0.0f };
 
+  // Objects attached to the paddle (e.g. the ball before launch) become its
+  // children and follow it in the same update pass.
+  TransformHierarchy transforms;
+  uint32_t paddle_node = transforms.create();
+
+  // Bricks only change when hit, so a BVH over the live ones serves culling
+  // and the ball's sweeps. Its items index bvh_bricks.
+  const char* level_paths[] = { "../res/levels/level_01.txt", "../res/levels/level_02.txt" };
+  const size_t level_count = sizeof(level_paths) / sizeof(level_paths[0]);
+  size_t level_index = 0;
+  Level level;
+  BVH brick_bvh;
+  std::vector<glm::vec3> brick_mins(Level::MAX_BRICKS);
+  std::vector<glm::vec3> brick_maxs(Level::MAX_BRICKS);
+  std::vector<uint32_t> bvh_bricks(Level::MAX_BRICKS);
+  uint32_t bvh_brick_count = 0;
+
+  // Brick i is node first_brick_node + i. Bricks never move, so their nodes
+  // are set up once per level and update() leaves them alone after that.
+  const uint32_t first_brick_node = transforms.get_count();
+
+  auto rebuild_brick_bvh = [&]()
+  {
+    glm::vec3 half_extents { level.get_brick_width() * 0.5f, level.get_brick_height() * 0.5f, level.get_brick_height() * 0.5f };
+    bvh_brick_count = 0;
+    for (uint32_t i = 0; i < level.get_brick_count(); ++i)
+    {
+      if (!level.is_alive(i)) continue;
+      glm::vec3 center { level.get_x()[i], level.get_y()[i], 0.0f };
+      brick_mins[bvh_brick_count] = center - half_extents;
+      brick_maxs[bvh_brick_count] = center + half_extents;
+      bvh_bricks[bvh_brick_count++] = i;
+    }
+    brick_bvh.build(job_system, brick_mins.data(), brick_maxs.data(), bvh_brick_count);
+  };
+
+  auto load_level = [&](size_t p_index)
+  {
+    uint64_t start = SDL_GetTicksNS();
+    if (!level.load(level_paths[p_index], "../res/cache")) return;
+    rebuild_brick_bvh();
+
+    transforms.truncate(first_brick_node);
+    glm::vec3 brick_scale { level.get_brick_width(), level.get_brick_height(), level.get_brick_height() };
+    for (uint32_t i = 0; i < level.get_brick_count(); ++i)
+    {
+      uint32_t node = transforms.create();
+      transforms.set_local(node, glm::scale(glm::translate(glm::mat4 { 1.0f }, glm::vec3 { level.get_x()[i], level.get_y()[i], 0.0f }), brick_scale));
+    }
+    transforms.update();
+    std::cerr << "LEVEL::LOADED " << level.get_name() << " (" << level.get_brick_count() << " bricks) in " << (SDL_GetTicksNS() - start) / 1e6 << " ms" << std::endl;
+  };
+  load_level(level_index);
+
+  ParticleSystem particles;
+  std::minstd_rand random;
+  bool spawn_key_was_down = false;
+  bool level_key_was_down = false;
+  bool memory_key_was_down = false;
+  bool show_perf_hud = false;
+  bool hud_key_was_down = false;
+  uint64_t last_frame_start = SDL_GetTicksNS();
+  float last_time = TIME_SEC;
+
   const bool* keystates = SDL_GetKeyboardState(nullptr);
 
+  // Transient per-frame data (draw lists, collision pairs, etc.) goes here.
+  // Double-buffered since the render thread reads the previous frame's data.
+  FrameArenas frame_arenas { 1 << 20 };
+  uint64_t frame_count = 0;
+  uint64_t worst_frame_allocations = 0;
+
   while (!done)
   {
+    uint64_t frame_start = SDL_GetTicksNS();
+    float frame_ms = (frame_start - last_frame_start) / 1e6f;
+    last_frame_start = frame_start;
+    uint64_t heap_count = HeapCounter::get_count();
+    FrameArena& frame_arena = frame_arenas.begin_frame();
+
     SDL_Event event;
     while (SDL_PollEvent(&event))
     {
@@ -272,28 +341,161 @@ int main(int argc, char* argv[])
       paddle_pos.x -= 0.0003;
     }
     paddle_pos.x = glm::clamp(paddle_pos.x, -1.5f, 1.5f);
+    transforms.set_position(paddle_node, paddle_pos);
+    transforms.update();
 
-    glEnable(GL_DEPTH_TEST);
-    glClearColor(0.3f, 0.1f, 0.3f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glDisable(GL_CULL_FACE);
+    float time = TIME_SEC;
+    float delta = time - last_time;
+    last_time = time;
 
-    glUseProgram(shader_program);
-    glBindVertexArray(vao);
+    if (keystates[SDL_SCANCODE_N] && !level_key_was_down)
+    {
+      level_index = (level_index + 1) % level_count;
+      load_level(level_index);
+    }
+    level_key_was_down = keystates[SDL_SCANCODE_N];
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    glUniform1i(glGetUniformLocation(shader_program, "u_texture"), 0);
+    if (keystates[SDL_SCANCODE_M] && !memory_key_was_down) MemoryTracker::print_report(std::cerr);
+    memory_key_was_down = keystates[SDL_SCANCODE_M];
 
-    glm::mat4 model { 1.0f };
-    model = glm::translate(model, paddle_pos);
-    int u_model = glGetUniformLocation(shader_program, "u_model");
-    glUniformMatrix4fv(u_model, 1, false, glm::value_ptr(model));
+    if (keystates[SDL_SCANCODE_F3] && !hud_key_was_down) show_perf_hud = !show_perf_hud;
+    hud_key_was_down = keystates[SDL_SCANCODE_F3];
 
-    glDrawElements(GL_TRIANGLES, mesh_data.indices.size(), GL_UNSIGNED_INT, 0);
+    // Debug trigger until there is a ball: sweeps a ball-sized sphere up from
+    // the paddle and hits the first brick in its way.
+    ParticleBurst* gpu_bursts = frame_arena.allocate_array<ParticleBurst>(1);
+    size_t gpu_burst_count = 0;
+    BVHHit brick_hit;
+    if (keystates[SDL_SCANCODE_SPACE] && !spawn_key_was_down && brick_bvh.sweep_sphere(paddle_pos, 0.1f, glm::vec3 { 0.0f, 1.0f, 0.0f }, Z_FAR, &brick_hit))
+    {
+      uint32_t brick = bvh_bricks[brick_hit.item];
+      bool destroyed = level.hit(brick);
+      const float* color = level.get_type(brick).color;
+
+      ParticleBurst burst;
+      burst.position = glm::vec3 { level.get_x()[brick], level.get_y()[brick], 0.0f };
+      burst.count = destroyed ? 2000 : 200;
+      burst.color = glm::vec3 { color[0], color[1], color[2] };
+      if (use_gpu_particles)
+        gpu_bursts[gpu_burst_count++] = burst;
+      else
+        particles.spawn(burst);
+
+      if (destroyed)
+      {
+        PowerUp power_up = level.roll_power_up(brick, (uint32_t)random());
+        if (power_up != POWER_UP_NONE) std::cerr << "LEVEL::POWER_UP " << Level::get_power_up_name(power_up) << std::endl;
+        rebuild_brick_bvh();
+      }
+    }
+    spawn_key_was_down = keystates[SDL_SCANCODE_SPACE];
+    particles.update(job_system, delta);
+
+    ParticleInstance* particle_instances = frame_arena.allocate_array<ParticleInstance>(particles.get_count());
+    particles.write_instances(particle_instances);
+
+    // Bricks are culled through their BVH and follow the paddle in the object
+    // list.
+    uint32_t* visible_bricks = frame_arena.allocate_array<uint32_t>(bvh_brick_count);
+    size_t visible_brick_count = brick_bvh.cull(frustum, visible_bricks, bvh_brick_count);
+
+    const size_t sphere_count = 1;
+    const size_t object_count = sphere_count + visible_brick_count;
+    RenderObject* objects = frame_arena.allocate_array<RenderObject>(object_count);
+    objects[0].model = transforms.get_world(paddle_node);
+    objects[0].color = glm::vec4 { 1.0f };
+
+    for (size_t i = 0; i < visible_brick_count; ++i)
+    {
+      uint32_t brick = bvh_bricks[visible_bricks[i]];
+      const float* color = level.get_type(brick).color;
+      RenderObject& object = objects[sphere_count + i];
+      object.model = transforms.get_world(first_brick_node + brick);
+      object.color = glm::vec4 { color[0], color[1], color[2], color[3] };
+    }
+
+    // World space bounding spheres, only objects inside the frustum get a
+    // draw packet.
+    float* sphere_x = frame_arena.allocate_array<float>(sphere_count);
+    float* sphere_y = frame_arena.allocate_array<float>(sphere_count);
+    float* sphere_z = frame_arena.allocate_array<float>(sphere_count);
+    float* sphere_radius = frame_arena.allocate_array<float>(sphere_count);
+    for (size_t i = 0; i < sphere_count; ++i)
+    {
+      glm::vec4 center = objects[i].model * glm::vec4 { pyramid.bounds_center, 1.0f };
+      sphere_x[i] = center.x;
+      sphere_y[i] = center.y;
+      sphere_z[i] = center.z;
+      sphere_radius[i] = pyramid.bounds_radius;
+    }
 
-    SDL_GL_SwapWindow(window);
+    uint8_t* visible = frame_arena.allocate_array<uint8_t>(sphere_count);
+    Culling::cull_spheres(job_system, frustum, { sphere_x, sphere_y, sphere_z, sphere_radius, sphere_count }, visible);
+
+    uint32_t* visible_spheres = frame_arena.allocate_array<uint32_t>(sphere_count);
+    size_t visible_sphere_count = Culling::compact(visible, sphere_count, visible_spheres);
+
+    RenderQueue render_queue { frame_arena };
+    TextureRequest* texture_requests = frame_arena.allocate_array<TextureRequest>(visible_sphere_count);
+    size_t texture_request_count = 0;
+    for (size_t v = 0; v < visible_sphere_count; ++v)
+    {
+      uint32_t i = visible_spheres[v];
+      float view_depth = -(view * glm::vec4 { sphere_x[i], sphere_y[i], sphere_z[i], 1.0f }).z;
+      render_queue.submit(RenderQueue::make_key(RenderQueue::LAYER_OPAQUE, 0, 0, 0, view_depth / Z_FAR), i);
+
+      // Projected diameter in pixels, the texture spans roughly the whole mesh.
+      float screen_size = sphere_radius[i] * projection[1][1] / glm::max(view_depth, Z_NEAR) * SCREEN_HEIGHT;
+      texture_requests[texture_request_count++] = { pyramid_texture.streamer_slot, screen_size };
+    }
+    for (size_t i = 0; i < visible_brick_count; ++i)
+    {
+      const glm::mat4& model = objects[sphere_count + i].model;
+      float view_depth = -(view * model[3]).z;
+      render_queue.submit(RenderQueue::make_key(RenderQueue::LAYER_OPAQUE, 0, 0, 1, view_depth / Z_FAR), (uint32_t)(sphere_count + i));
+    }
+    render_queue.sort();
+
+    RenderSnapshot snapshot;
+    snapshot.frame = frame_count;
+    snapshot.time = time;
+    snapshot.delta = delta;
+    snapshot.view = view;
+    snapshot.projection = projection;
+    snapshot.objects = objects;
+    snapshot.object_count = object_count;
+    snapshot.packets = render_queue.get_packets();
+    snapshot.packet_count = render_queue.get_packet_count();
+    snapshot.particles = particle_instances;
+    snapshot.particle_count = particles.get_count();
+    snapshot.gpu_bursts = gpu_bursts;
+    snapshot.gpu_burst_count = gpu_burst_count;
+    snapshot.texture_requests = texture_requests;
+    snapshot.texture_request_count = texture_request_count;
+    snapshot.show_perf_hud = show_perf_hud;
+    snapshot.frame_ms = frame_ms;
+    snapshot.simulation_ms = (SDL_GetTicksNS() - frame_start) / 1e6f;
+
+    // Blocks until the previous frame has been drawn, so the arena we reset
+    // at the top of the next iteration is no longer in use.
+    render_thread.submit(snapshot);
+
+#ifndef NDEBUG
+    // Steady-state frames should not touch the heap, skip the first few while
+    // drivers and arenas warm up.
+    uint64_t frame_allocations = HeapCounter::get_count() - heap_count;
+    if (frame_allocations > worst_frame_allocations && frame_count > 8)
+    {
+      worst_frame_allocations = frame_allocations;
+      std::cerr << "WARNING::FRAME::HEAP_ALLOCATIONS " << frame_allocations << " (frame arena used " << frame_arena.get_used() << " bytes)" << std::endl;
+    }
+#endif
+    MemoryTracker::end_frame();
+    frame_count++;
   }
 
+  render_thread.stop();
+  MemoryTracker::print_report(std::cerr);
+
   return 0;
 }
@@ -0,0 +1,212 @@
+#include "./memory_tracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+// Written in front of every tracked allocation. 16 bytes keeps the returned
+// pointer aligned for any fundamental type.
+struct AllocationHeader
+{
+  uint64_t size;
+  uint32_t tag;
+  uint32_t pad;
+};
+static_assert(sizeof(AllocationHeader) % alignof(std::max_align_t) == 0, "header breaks alignment");
+
+struct TagCounters
+{
+  std::atomic<size_t> cpu_live { 0 };
+  std::atomic<size_t> cpu_peak { 0 };
+  std::atomic<size_t> gpu_live { 0 };
+  std::atomic<size_t> gpu_peak { 0 };
+  std::atomic<uint64_t> allocations { 0 };
+  std::atomic<uint64_t> bytes { 0 };
+  std::atomic<size_t> budget { 0 };
+
+  // Snapshots taken by end_frame().
+  std::atomic<uint64_t> frame_start_allocations { 0 };
+  std::atomic<uint64_t> frame_start_bytes { 0 };
+  std::atomic<uint64_t> frame_allocations { 0 };
+  std::atomic<uint64_t> frame_bytes { 0 };
+  bool over_budget = false;
+};
+
+// Zero initialized before any constructor runs, so allocations made during
+// static initialization are counted too.
+static TagCounters counters[MEMORY_TAG_MAX];
+static thread_local MemoryTag thread_tag = MEMORY_TAG_GENERAL;
+
+static const char* TAG_NAMES[MEMORY_TAG_MAX] = { "general", "assets", "render", "gameplay", "audio" };
+
+static void raise_peak(std::atomic<size_t>& r_peak, size_t p_value)
+{
+  size_t peak = r_peak.load(std::memory_order_relaxed);
+  while (p_value > peak && !r_peak.compare_exchange_weak(peak, p_value, std::memory_order_relaxed))
+  {
+  }
+}
+
+// Fills in the header right before p_ptr and counts the allocation.
+static void* track_allocation(void* p_ptr, size_t p_size)
+{
+  MemoryTag tag = thread_tag;
+  AllocationHeader* header = static_cast<AllocationHeader*>(p_ptr) - 1;
+  header->size = p_size;
+  header->tag = tag;
+
+  TagCounters& tag_counters = counters[tag];
+  tag_counters.allocations.fetch_add(1, std::memory_order_relaxed);
+  tag_counters.bytes.fetch_add(p_size, std::memory_order_relaxed);
+  size_t live = tag_counters.cpu_live.fetch_add(p_size, std::memory_order_relaxed) + p_size;
+  raise_peak(tag_counters.cpu_peak, live);
+  return p_ptr;
+}
+
+static void track_free(void* p_ptr)
+{
+  AllocationHeader* header = static_cast<AllocationHeader*>(p_ptr) - 1;
+  counters[header->tag].cpu_live.fetch_sub(header->size, std::memory_order_relaxed);
+}
+
+// Bytes in front of an over-aligned allocation: the header, padded so the
+// pointer after it keeps the alignment.
+static size_t get_aligned_prefix(std::align_val_t p_alignment)
+{
+  return std::max((size_t)p_alignment, sizeof(AllocationHeader));
+}
+
+// Array and nothrow forms aren't replaced, their defaults call these.
+void* operator new(size_t p_size)
+{
+  AllocationHeader* header = static_cast<AllocationHeader*>(std::malloc(sizeof(AllocationHeader) + p_size));
+  if (header == nullptr) throw std::bad_alloc {};
+  return track_allocation(header + 1, p_size);
+}
+
+void operator delete(void* p_ptr) noexcept
+{
+  if (p_ptr == nullptr) return;
+  track_free(p_ptr);
+  std::free(static_cast<AllocationHeader*>(p_ptr) - 1);
+}
+
+void operator delete(void* p_ptr, size_t) noexcept
+{
+  operator delete(p_ptr);
+}
+
+// Types above the default new alignment, e.g. cache line aligned workers.
+void* operator new(size_t p_size, std::align_val_t p_alignment)
+{
+  size_t prefix = get_aligned_prefix(p_alignment);
+  size_t alignment = (size_t)p_alignment;
+  size_t size = (prefix + p_size + alignment - 1) / alignment * alignment;
+  unsigned char* block = static_cast<unsigned char*>(std::aligned_alloc(alignment, size));
+  if (block == nullptr) throw std::bad_alloc {};
+  return track_allocation(block + prefix, p_size);
+}
+
+void operator delete(void* p_ptr, std::align_val_t p_alignment) noexcept
+{
+  if (p_ptr == nullptr) return;
+  track_free(p_ptr);
+  std::free(static_cast<unsigned char*>(p_ptr) - get_aligned_prefix(p_alignment));
+}
+
+void operator delete(void* p_ptr, size_t, std::align_val_t p_alignment) noexcept
+{
+  operator delete(p_ptr, p_alignment);
+}
+
+MemoryTag MemoryTracker::get_thread_tag()
+{
+  return thread_tag;
+}
+
+void MemoryTracker::set_thread_tag(MemoryTag p_tag)
+{
+  thread_tag = p_tag;
+}
+
+void MemoryTracker::add_gpu(MemoryTag p_tag, size_t p_bytes)
+{
+  size_t live = counters[p_tag].gpu_live.fetch_add(p_bytes, std::memory_order_relaxed) + p_bytes;
+  raise_peak(counters[p_tag].gpu_peak, live);
+}
+
+void MemoryTracker::remove_gpu(MemoryTag p_tag, size_t p_bytes)
+{
+  counters[p_tag].gpu_live.fetch_sub(p_bytes, std::memory_order_relaxed);
+}
+
+void MemoryTracker::set_budget(MemoryTag p_tag, size_t p_bytes)
+{
+  counters[p_tag].budget.store(p_bytes, std::memory_order_relaxed);
+}
+
+void MemoryTracker::end_frame()
+{
+  for (int i = 0; i < MEMORY_TAG_MAX; ++i)
+  {
+    TagCounters& tag_counters = counters[i];
+    uint64_t allocations = tag_counters.allocations.load(std::memory_order_relaxed);
+    uint64_t bytes = tag_counters.bytes.load(std::memory_order_relaxed);
+    tag_counters.frame_allocations.store(allocations - tag_counters.frame_start_allocations.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    tag_counters.frame_bytes.store(bytes - tag_counters.frame_start_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    tag_counters.frame_start_allocations.store(allocations, std::memory_order_relaxed);
+    tag_counters.frame_start_bytes.store(bytes, std::memory_order_relaxed);
+
+    // Warn once per crossing, not every frame.
+    size_t budget = tag_counters.budget.load(std::memory_order_relaxed);
+    size_t used = tag_counters.cpu_live.load(std::memory_order_relaxed) + tag_counters.gpu_live.load(std::memory_order_relaxed);
+    bool over_budget = budget != 0 && used > budget;
+    if (over_budget && !tag_counters.over_budget)
+      std::cerr << "WARNING::MEMORY::OVER_BUDGET " << TAG_NAMES[i] << " " << used << " of " << budget << " bytes" << std::endl;
+    tag_counters.over_budget = over_budget;
+  }
+}
+
+MemoryStats MemoryTracker::get_stats(MemoryTag p_tag)
+{
+  const TagCounters& tag_counters = counters[p_tag];
+  MemoryStats stats;
+  stats.cpu_live = tag_counters.cpu_live.load(std::memory_order_relaxed);
+  stats.cpu_peak = tag_counters.cpu_peak.load(std::memory_order_relaxed);
+  stats.gpu_live = tag_counters.gpu_live.load(std::memory_order_relaxed);
+  stats.gpu_peak = tag_counters.gpu_peak.load(std::memory_order_relaxed);
+  stats.frame_allocations = tag_counters.frame_allocations.load(std::memory_order_relaxed);
+  stats.frame_bytes = tag_counters.frame_bytes.load(std::memory_order_relaxed);
+  stats.budget = tag_counters.budget.load(std::memory_order_relaxed);
+  return stats;
+}
+
+const char* MemoryTracker::get_tag_name(MemoryTag p_tag)
+{
+  return TAG_NAMES[p_tag];
+}
+
+uint64_t MemoryTracker::get_allocation_count()
+{
+  uint64_t count = 0;
+  for (const TagCounters& tag_counters : counters) count += tag_counters.allocations.load(std::memory_order_relaxed);
+  return count;
+}
+
+void MemoryTracker::print_report(std::ostream& r_stream)
+{
+  auto kib = [](size_t p_bytes) { return (p_bytes + 1023) / 1024; };
+  for (int i = 0; i < MEMORY_TAG_MAX; ++i)
+  {
+    MemoryStats stats = get_stats((MemoryTag)i);
+    r_stream << "MEMORY::" << std::left << std::setw(9) << TAG_NAMES[i] << std::right
+             << " cpu " << std::setw(7) << kib(stats.cpu_live) << " KiB (peak " << kib(stats.cpu_peak) << ")"
+             << " gpu " << std::setw(7) << kib(stats.gpu_live) << " KiB (peak " << kib(stats.gpu_peak) << ")"
+             << " frame " << stats.frame_allocations << " allocs / " << stats.frame_bytes << " bytes";
+    if (stats.budget != 0) r_stream << " budget " << kib(stats.budget) << " KiB";
+    r_stream << std::endl;
+  }
+}
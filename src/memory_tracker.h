@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+enum MemoryTag : uint8_t
+{
+  MEMORY_TAG_GENERAL,
+  MEMORY_TAG_ASSETS,
+  MEMORY_TAG_RENDER,
+  MEMORY_TAG_GAMEPLAY,
+  MEMORY_TAG_AUDIO,
+  MEMORY_TAG_MAX
+};
+
+struct MemoryStats
+{
+  size_t cpu_live = 0;
+  size_t cpu_peak = 0;
+  // Estimated from buffer and texture sizes, drivers add their own padding.
+  size_t gpu_live = 0;
+  size_t gpu_peak = 0;
+  // Heap allocations and bytes during the last frame, see end_frame().
+  uint64_t frame_allocations = 0;
+  uint64_t frame_bytes = 0;
+  // 0 for no budget.
+  size_t budget = 0;
+};
+
+// Heap and GPU memory per subsystem. Every global operator new, over-aligned
+// ones included, is attributed to the calling thread's current tag (see
+// MemoryScope) and carries a small header so delete can give the bytes back to
+// the same tag. GPU memory is reported by the code creating buffers and
+// textures. Counters are relaxed atomics, cheap enough to stay on in release
+// builds.
+class MemoryTracker
+{
+  public:
+  static MemoryTag get_thread_tag();
+  static void set_thread_tag(MemoryTag p_tag);
+
+  static void add_gpu(MemoryTag p_tag, size_t p_bytes);
+  static void remove_gpu(MemoryTag p_tag, size_t p_bytes);
+
+  // CPU plus GPU bytes a tag may use, 0 for no limit. Checked in end_frame().
+  static void set_budget(MemoryTag p_tag, size_t p_bytes);
+
+  // Closes the frame for the per-frame counters and warns about tags over
+  // their budget. Once per simulation frame.
+  static void end_frame();
+
+  static MemoryStats get_stats(MemoryTag p_tag);
+  static const char* get_tag_name(MemoryTag p_tag);
+
+  // Heap allocations since startup, all tags.
+  static uint64_t get_allocation_count();
+
+  // One line per tag.
+  static void print_report(std::ostream& r_stream);
+};
+
+// Tags the calling thread's allocations for the lifetime of the scope.
+class MemoryScope
+{
+  public:
+  explicit MemoryScope(MemoryTag p_tag) :
+      previous(MemoryTracker::get_thread_tag())
+  {
+    MemoryTracker::set_thread_tag(p_tag);
+  }
+
+  ~MemoryScope() { MemoryTracker::set_thread_tag(previous); }
+
+  MemoryScope(const MemoryScope&) = delete;
+  MemoryScope& operator=(const MemoryScope&) = delete;
+
+  private:
+  MemoryTag previous;
+};
@@ -0,0 +1,273 @@
+#include "./mesh_loader.h"
+
+#include "./base64.h"
+#include "./frame_arena.h"
+#include "./gltf_parser.h"
+#include "./utils.h"
+
+#include <cstring>
+#include <iostream>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// Undoes %XX escapes in relative URIs ("my%20mesh.bin").
+static std::string decode_uri(std::string_view p_uri)
+{
+  std::string path;
+  path.reserve(p_uri.size());
+  for (size_t i = 0; i < p_uri.size(); ++i)
+  {
+    if (p_uri[i] == '%' && i + 2 < p_uri.size())
+    {
+      path += (char)std::strtol(std::string { p_uri.substr(i + 1, 2) }.c_str(), nullptr, 16);
+      i += 2;
+    }
+    else
+    {
+      path += p_uri[i];
+    }
+  }
+  return path;
+}
+
+// Contents of a data URI or a file relative to the glTF.
+static bool read_uri(std::string_view p_uri, const std::string& p_base_dir, std::vector<unsigned char>& r_content)
+{
+  if (p_uri.rfind("data:", 0) == 0)
+  {
+    size_t comma = p_uri.find(',');
+    if (comma == std::string_view::npos || p_uri.substr(0, comma).find(";base64") == std::string_view::npos) return false;
+    std::string_view encoded = p_uri.substr(comma + 1);
+    r_content.resize(Base64::get_decoded_size(encoded.size()));
+    size_t size = Base64::decode(encoded.data(), encoded.size(), r_content.data(), r_content.size());
+    r_content.resize(size);
+    return size > 0 || encoded.empty();
+  }
+  return Utils::read_file(p_base_dir + decode_uri(p_uri), r_content);
+}
+
+// Element p_index of an accessor, bounds checked against its buffer view.
+static const unsigned char* get_element(const GltfDocument& p_document, const std::vector<std::vector<unsigned char>>& p_buffers, const GltfAccessor& p_accessor, uint32_t p_element_size, size_t& r_stride)
+{
+  if (p_accessor.buffer_view < 0) return nullptr;
+  const GltfBufferView& view = p_document.buffer_views[p_accessor.buffer_view];
+  const std::vector<unsigned char>& buffer = p_buffers[view.buffer];
+
+  r_stride = view.byte_stride != 0 ? view.byte_stride : p_element_size;
+  size_t needed = p_accessor.count == 0 ? 0 : (size_t)p_accessor.byte_offset + (p_accessor.count - 1) * r_stride + p_element_size;
+  if ((size_t)view.byte_offset + view.byte_length > buffer.size() || needed > view.byte_length) return nullptr;
+  return buffer.data() + view.byte_offset + p_accessor.byte_offset;
+}
+
+static bool read_floats(const GltfDocument& p_document, const std::vector<std::vector<unsigned char>>& p_buffers, int32_t p_accessor, uint32_t p_components, std::vector<float>& r_values)
+{
+  if (p_accessor < 0) return false;
+  const GltfAccessor& accessor = p_document.accessors[p_accessor];
+  if (accessor.component_type != GltfParser::COMPONENT_FLOAT || accessor.components != p_components) return false;
+
+  size_t element_size = p_components * sizeof(float);
+  size_t stride;
+  const unsigned char* src = get_element(p_document, p_buffers, accessor, (uint32_t)element_size, stride);
+  if (src == nullptr) return false;
+
+  r_values.resize((size_t)accessor.count * p_components);
+  for (size_t i = 0; i < accessor.count; ++i) memcpy(r_values.data() + i * p_components, src + i * stride, element_size);
+  return true;
+}
+
+static bool read_indices(const GltfDocument& p_document, const std::vector<std::vector<unsigned char>>& p_buffers, int32_t p_accessor, std::vector<uint32_t>& r_indices)
+{
+  const GltfAccessor& accessor = p_document.accessors[p_accessor];
+  uint32_t size = GltfParser::get_component_size(accessor.component_type);
+  size_t stride;
+  const unsigned char* src = get_element(p_document, p_buffers, accessor, size, stride);
+  if (src == nullptr || accessor.components != 1) return false;
+
+  r_indices.resize(accessor.count);
+  for (size_t i = 0; i < r_indices.size(); ++i)
+  {
+    const unsigned char* element = src + i * stride;
+    if (accessor.component_type == GltfParser::COMPONENT_UNSIGNED_BYTE)
+    {
+      r_indices[i] = *element;
+    }
+    else if (accessor.component_type == GltfParser::COMPONENT_UNSIGNED_SHORT)
+    {
+      uint16_t index;
+      memcpy(&index, element, sizeof(index));
+      r_indices[i] = index;
+    }
+    else if (accessor.component_type == GltfParser::COMPONENT_UNSIGNED_INT)
+    {
+      memcpy(&r_indices[i], element, sizeof(uint32_t));
+    }
+    else
+    {
+      std::cerr << "Unsupported glTF index type!" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+MeshData MeshLoader::load(const std::string& p_filepath)
+{
+  std::vector<unsigned char> text;
+  if (!Utils::read_file(p_filepath, text))
+  {
+    std::cerr << "ERROR::MESH_LOADER::READ_FAILED " << p_filepath << std::endl;
+    return MeshData {};
+  }
+
+  // The parsed structures are a fraction of the JSON they came from, strings
+  // stay in the text.
+  FrameArena arena { text.size() / 2 + 4096 };
+  GltfDocument document;
+  if (!GltfParser::parse(reinterpret_cast<const char*>(text.data()), text.size(), arena, document))
+  {
+    std::cerr << "ERROR::MESH_LOADER::PARSE_FAILED " << p_filepath << std::endl;
+    return MeshData {};
+  }
+
+  std::string base_dir = p_filepath.substr(0, p_filepath.find_last_of('/') + 1);
+  std::vector<std::vector<unsigned char>> buffers(document.buffers.count);
+  for (uint32_t i = 0; i < document.buffers.count; ++i)
+  {
+    const GltfBuffer& buffer = document.buffers[i];
+    if (buffer.uri.empty() || !read_uri(buffer.uri, base_dir, buffers[i]) || buffers[i].size() < buffer.byte_length)
+    {
+      std::cerr << "ERROR::MESH_LOADER::BUFFER_FAILED " << p_filepath << " buffer " << i << std::endl;
+      return MeshData {};
+    }
+  }
+
+  // Assuming mesh 0, primitive 0, one material.
+  if (document.meshes.count == 0 || document.meshes[0].primitives.count == 0)
+  {
+    std::cerr << "ERROR::MESH_LOADER::NO_MESH " << p_filepath << std::endl;
+    return MeshData {};
+  }
+  const GltfPrimitive& primitive = document.meshes[0].primitives[0];
+
+  MeshData mesh_data;
+  if (!read_floats(document, buffers, primitive.position, 3, mesh_data.positions) || !read_floats(document, buffers, primitive.tex_coord, 2, mesh_data.tex_coords))
+  {
+    std::cerr << "ERROR::MESH_LOADER::UNSUPPORTED_ATTRIBUTES " << p_filepath << std::endl;
+    return MeshData {};
+  }
+  if (primitive.indices >= 0)
+  {
+    if (!read_indices(document, buffers, primitive.indices, mesh_data.indices)) return MeshData {};
+  }
+  else
+  {
+    mesh_data.indices.resize(mesh_data.positions.size() / 3);
+    for (size_t i = 0; i < mesh_data.indices.size(); ++i) mesh_data.indices[i] = (uint32_t)i;
+  }
+
+  int32_t image_index = -1;
+  if (primitive.material >= 0)
+  {
+    int32_t texture = document.materials[primitive.material].base_color_texture;
+    if (texture >= 0) image_index = document.textures[texture].source;
+  }
+
+  if (image_index >= 0)
+  {
+    const GltfImage& image = document.images[image_index];
+    std::vector<unsigned char> encoded;
+    const unsigned char* bytes = nullptr;
+    size_t size = 0;
+    if (image.buffer_view >= 0)
+    {
+      const GltfBufferView& view = document.buffer_views[image.buffer_view];
+      if ((size_t)view.byte_offset + view.byte_length <= buffers[view.buffer].size())
+      {
+        bytes = buffers[view.buffer].data() + view.byte_offset;
+        size = view.byte_length;
+      }
+    }
+    else if (read_uri(image.uri, base_dir, encoded))
+    {
+      bytes = encoded.data();
+      size = encoded.size();
+    }
+
+    // Always RGBA, the streamer and cooker expect 4 components.
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    unsigned char* pixels = bytes != nullptr ? stbi_load_from_memory(bytes, (int)size, &width, &height, &components, 4) : nullptr;
+    if (pixels != nullptr)
+    {
+      mesh_data.pixels.assign(pixels, pixels + (size_t)width * height * 4);
+      mesh_data.image_width = width;
+      mesh_data.image_height = height;
+      mesh_data.image_components = 4;
+      stbi_image_free(pixels);
+    }
+    else
+    {
+      std::cerr << "ERROR::MESH_LOADER::IMAGE_FAILED " << p_filepath << " image " << image_index << std::endl;
+    }
+
+    if (image.uri.empty() || image.uri.rfind("data:", 0) == 0)
+      mesh_data.image_source = p_filepath;
+    else
+      mesh_data.image_source = base_dir + decode_uri(image.uri);
+  }
+
+  std::vector<float>& positions = mesh_data.positions;
+  if (!positions.empty())
+  {
+    mesh_data.bounds_min = glm::vec3 { positions[0], positions[1], positions[2] };
+    mesh_data.bounds_max = mesh_data.bounds_min;
+    for (size_t i = 0; i < positions.size(); i += 3)
+    {
+      glm::vec3 position { positions[i], positions[i + 1], positions[i + 2] };
+      mesh_data.bounds_min = glm::min(mesh_data.bounds_min, position);
+      mesh_data.bounds_max = glm::max(mesh_data.bounds_max, position);
+    }
+
+    mesh_data.bounds_center = (mesh_data.bounds_min + mesh_data.bounds_max) * 0.5f;
+    for (size_t i = 0; i < positions.size(); i += 3)
+    {
+      glm::vec3 position { positions[i], positions[i + 1], positions[i + 2] };
+      mesh_data.bounds_radius = glm::max(mesh_data.bounds_radius, glm::distance(position, mesh_data.bounds_center));
+    }
+  }
+
+  return mesh_data;
+}
+
+MeshData MeshLoader::make_box(const glm::vec3& p_half_extents)
+{
+  MeshData mesh_data;
+
+  // Per face: normal axis and the two axes spanning it.
+  const int axes[3][3] = { { 0, 1, 2 }, { 1, 2, 0 }, { 2, 0, 1 } };
+  for (const int* axis : axes)
+  {
+    for (float side : { -1.0f, 1.0f })
+    {
+      uint32_t first = (uint32_t)(mesh_data.positions.size() / 3);
+      const float corners[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+      for (const float* corner : corners)
+      {
+        glm::vec3 position;
+        position[axis[0]] = side * p_half_extents[axis[0]];
+        position[axis[1]] = corner[0] * p_half_extents[axis[1]];
+        position[axis[2]] = corner[1] * p_half_extents[axis[2]];
+        mesh_data.positions.insert(mesh_data.positions.end(), { position.x, position.y, position.z });
+        mesh_data.tex_coords.insert(mesh_data.tex_coords.end(), { corner[0] * 0.5f + 0.5f, corner[1] * 0.5f + 0.5f });
+      }
+      mesh_data.indices.insert(mesh_data.indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+    }
+  }
+
+  mesh_data.bounds_min = -p_half_extents;
+  mesh_data.bounds_max = p_half_extents;
+  mesh_data.bounds_radius = glm::length(p_half_extents);
+  return mesh_data;
+}
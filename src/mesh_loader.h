@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// CPU side result of a glTF import, see GeometryPool for the GPU layout.
+struct MeshData
+{
+  std::vector<float> positions;
+  std::vector<float> tex_coords;
+  std::vector<uint32_t> indices;
+
+  // Base color texture, uploaded by the TextureStreamer.
+  std::vector<unsigned char> pixels;
+  uint32_t image_width = 0;
+  uint32_t image_height = 0;
+  int image_components = 4;
+  // File the pixels came from, keys the cooked texture cache.
+  std::string image_source;
+
+  // Local space bounds, for culling.
+  glm::vec3 bounds_min { 0.0f };
+  glm::vec3 bounds_max { 0.0f };
+  glm::vec3 bounds_center { 0.0f };
+  float bounds_radius = 0.0f;
+};
+
+class MeshLoader
+{
+  public:
+  // First primitive of the first mesh, with its base color image decoded.
+  // Returns empty data on failure, errors are logged.
+  static MeshData load(const std::string& p_filepath);
+
+  // Axis aligned box around the origin, each face mapping the full texture.
+  static MeshData make_box(const glm::vec3& p_half_extents);
+};
@@ -0,0 +1,200 @@
+#include "./particle_system.h"
+#include "./simd.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+ParticleSystem::ParticleSystem()
+{
+  // Round up so SIMD loops can run over whole vectors past count.
+  size_t capacity = (MAX_PARTICLES + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+  for (std::vector<float>* array : { &position_x, &position_y, &position_z, &velocity_x, &velocity_y, &velocity_z, &life, &inverse_lifetime, &size })
+  {
+    array->assign(capacity, 0.0f);
+  }
+  color.assign(capacity, 0);
+}
+
+float ParticleSystem::random()
+{
+  // xorshift32, [0, 1).
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return (rng_state >> 8) * (1.0f / 16777216.0f);
+}
+
+void ParticleSystem::spawn(const ParticleBurst& p_burst)
+{
+  uint32_t spawn_count = std::min(p_burst.count, MAX_PARTICLES - count);
+  uint32_t rgb = (uint32_t)(glm::clamp(p_burst.color.x, 0.0f, 1.0f) * 255.0f)
+      | (uint32_t)(glm::clamp(p_burst.color.y, 0.0f, 1.0f) * 255.0f) << 8
+      | (uint32_t)(glm::clamp(p_burst.color.z, 0.0f, 1.0f) * 255.0f) << 16;
+
+  for (uint32_t i = count; i < count + spawn_count; ++i)
+  {
+    // Uniform direction on the sphere, speed varies a bit per particle.
+    float z = random() * 2.0f - 1.0f;
+    float angle = random() * 6.2831853f;
+    float ring = std::sqrt(1.0f - z * z);
+    float speed = p_burst.speed * (0.5f + random());
+
+    position_x[i] = p_burst.position.x;
+    position_y[i] = p_burst.position.y;
+    position_z[i] = p_burst.position.z;
+    velocity_x[i] = ring * std::cos(angle) * speed;
+    velocity_y[i] = ring * std::sin(angle) * speed;
+    velocity_z[i] = z * speed;
+
+    float lifetime = p_burst.lifetime * (0.75f + 0.5f * random());
+    life[i] = lifetime;
+    inverse_lifetime[i] = 1.0f / lifetime;
+    size[i] = p_burst.size;
+    color[i] = rgb;
+  }
+  count += spawn_count;
+}
+
+void ParticleSystem::integrate(size_t p_begin, size_t p_end, float p_delta)
+{
+  float damping = std::max(0.0f, 1.0f - drag * p_delta);
+  size_t i = p_begin;
+
+#if SIMD_WIDTH > 1
+  const vfloat delta = v_set(p_delta);
+  const vfloat damp = v_set(damping);
+  const vfloat gravity_x = v_set(gravity.x * p_delta);
+  const vfloat gravity_y = v_set(gravity.y * p_delta);
+  const vfloat gravity_z = v_set(gravity.z * p_delta);
+
+  // The arrays are padded, the last vector may run past p_end harmlessly.
+  for (; i < p_end; i += SIMD_WIDTH)
+  {
+    vfloat vx = v_mul(v_add(v_load(&velocity_x[i]), gravity_x), damp);
+    vfloat vy = v_mul(v_add(v_load(&velocity_y[i]), gravity_y), damp);
+    vfloat vz = v_mul(v_add(v_load(&velocity_z[i]), gravity_z), damp);
+    v_store(&velocity_x[i], vx);
+    v_store(&velocity_y[i], vy);
+    v_store(&velocity_z[i], vz);
+
+    v_store(&position_x[i], v_add(v_load(&position_x[i]), v_mul(vx, delta)));
+    v_store(&position_y[i], v_add(v_load(&position_y[i]), v_mul(vy, delta)));
+    v_store(&position_z[i], v_add(v_load(&position_z[i]), v_mul(vz, delta)));
+
+    v_store(&life[i], v_sub(v_load(&life[i]), delta));
+  }
+#else
+  for (; i < p_end; ++i)
+  {
+    velocity_x[i] = (velocity_x[i] + gravity.x * p_delta) * damping;
+    velocity_y[i] = (velocity_y[i] + gravity.y * p_delta) * damping;
+    velocity_z[i] = (velocity_z[i] + gravity.z * p_delta) * damping;
+    position_x[i] += velocity_x[i] * p_delta;
+    position_y[i] += velocity_y[i] * p_delta;
+    position_z[i] += velocity_z[i] * p_delta;
+    life[i] -= p_delta;
+  }
+#endif
+}
+
+void ParticleSystem::update(JobSystem& p_jobs, float p_delta)
+{
+  if (count == 0) return;
+
+  // Batches are a multiple of every SIMD width so vectors never straddle two.
+  const size_t batch_size = 8192;
+  if (count <= batch_size)
+  {
+    integrate(0, count, p_delta);
+  }
+  else
+  {
+    p_jobs.parallel_for(count, batch_size, [&](size_t p_begin, size_t p_end)
+    {
+      integrate(p_begin, p_end, p_delta);
+    });
+  }
+
+  // Swap-remove the dead ones, order doesn't matter with additive blending.
+  uint32_t i = 0;
+  while (i < count)
+  {
+    if (life[i] > 0.0f)
+    {
+      i++;
+      continue;
+    }
+
+    uint32_t last = --count;
+    position_x[i] = position_x[last];
+    position_y[i] = position_y[last];
+    position_z[i] = position_z[last];
+    velocity_x[i] = velocity_x[last];
+    velocity_y[i] = velocity_y[last];
+    velocity_z[i] = velocity_z[last];
+    life[i] = life[last];
+    inverse_lifetime[i] = inverse_lifetime[last];
+    size[i] = size[last];
+    color[i] = color[last];
+  }
+}
+
+void ParticleSystem::write_instances(ParticleInstance* r_instances) const
+{
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    float alpha = glm::clamp(life[i] * inverse_lifetime[i], 0.0f, 1.0f);
+    r_instances[i] = { position_x[i], position_y[i], position_z[i], size[i], color[i] | (uint32_t)(alpha * 255.0f) << 24 };
+  }
+}
+
+void ParticleRenderer::init(GLStateCache& p_state, unsigned int p_program)
+{
+  program = p_program;
+  instances.init(p_state, GL_ARRAY_BUFFER, ParticleSystem::MAX_PARTICLES * sizeof(ParticleInstance) * 3);
+
+  // Attribute pointers are set per draw since the ring offset moves.
+  glGenVertexArrays(1, &vao);
+  p_state.bind_vertex_array(vao);
+  for (GLuint attribute = 0; attribute < 2; ++attribute)
+  {
+    glEnableVertexAttribArray(attribute);
+    glVertexAttribDivisor(attribute, 1);
+  }
+}
+
+void ParticleRenderer::draw(GLStateCache& p_state, const ParticleInstance* p_instances, size_t p_count)
+{
+  if (p_count == 0) return;
+
+  GLintptr offset = 0;
+  void* data = instances.map(p_state, p_count * sizeof(ParticleInstance), sizeof(ParticleInstance), &offset);
+  if (!data) return;
+  memcpy(data, p_instances, p_count * sizeof(ParticleInstance));
+  instances.unmap(p_state);
+
+  p_state.use_program(program);
+  p_state.bind_vertex_array(vao);
+  p_state.bind_buffer(GL_ARRAY_BUFFER, instances.get_buffer());
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offset);
+  glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ParticleInstance), (void*)(offset + offsetof(ParticleInstance, color)));
+
+  // Additive, depth tested against the scene but not written.
+  p_state.enable(GL_BLEND);
+  p_state.blend_func(GL_SRC_ALPHA, GL_ONE);
+  p_state.depth_mask(false);
+
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, p_count);
+  p_state.count_draw((uint32_t)(2 * p_count));
+
+  p_state.depth_mask(true);
+  p_state.disable(GL_BLEND);
+}
+
+void ParticleRenderer::end_frame()
+{
+  instances.fence();
+}
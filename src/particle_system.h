@@ -0,0 +1,79 @@
+#pragma once
+
+#include "./gl_state_cache.h"
+#include "./job_system.h"
+#include "./stream_buffer.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-particle data the renderer needs, one instance of the billboard quad.
+struct ParticleInstance
+{
+  float x, y, z;
+  float size;
+  uint32_t color;
+};
+
+struct ParticleBurst
+{
+  glm::vec3 position { 0.0f };
+  uint32_t count = 64;
+  float speed = 2.0f;
+  float lifetime = 1.0f;
+  float size = 0.04f;
+  glm::vec3 color { 1.0f };
+};
+
+// CPU particles for debris and sparks. Attributes live in separate arrays
+// padded to the SIMD width, update() integrates gravity, drag and lifetime a
+// vector at a time and then swap-removes dead particles, so the live range is
+// always [0, count). Simulation thread only.
+class ParticleSystem
+{
+  public:
+  static constexpr uint32_t MAX_PARTICLES = 131072;
+
+  ParticleSystem();
+
+  void spawn(const ParticleBurst& p_burst);
+  void update(JobSystem& p_jobs, float p_delta);
+
+  // Writes get_count() instances, alpha fades with remaining life.
+  void write_instances(ParticleInstance* r_instances) const;
+
+  uint32_t get_count() const { return count; }
+
+  glm::vec3 gravity { 0.0f, -4.0f, 0.0f };
+  float drag = 0.8f;
+
+  private:
+  void integrate(size_t p_begin, size_t p_end, float p_delta);
+  float random();
+
+  std::vector<float> position_x, position_y, position_z;
+  std::vector<float> velocity_x, velocity_y, velocity_z;
+  std::vector<float> life, inverse_lifetime, size;
+  std::vector<uint32_t> color;
+
+  uint32_t count = 0;
+  uint32_t rng_state = 0x9E3779B9u;
+};
+
+// Draws particle instances as camera-facing quads with one instanced draw,
+// instance data goes through a streaming ring buffer. Render thread only.
+class ParticleRenderer
+{
+  public:
+  void init(GLStateCache& p_state, unsigned int p_program);
+  void draw(GLStateCache& p_state, const ParticleInstance* p_instances, size_t p_count);
+  void end_frame();
+
+  private:
+  unsigned int program = 0;
+  GLuint vao = 0;
+  StreamBuffer instances;
+};
@@ -0,0 +1,319 @@
+#include "./perf_hud.h"
+
+#include "./memory_tracker.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+// Atlas of 6x8 texel cells for ASCII 32-127, 5x7 glyphs in the top left of
+// each cell. Lower case shares the upper case glyphs, DEL is a solid cell.
+static constexpr int CELL_WIDTH = 6;
+static constexpr int CELL_HEIGHT = 8;
+static constexpr int ATLAS_COLUMNS = 16;
+static constexpr int ATLAS_ROWS = 6;
+static constexpr uint32_t SOLID_GLYPH = 127;
+
+// Pixels per atlas texel.
+static constexpr float SCALE = 2.0f;
+static constexpr float LINE_HEIGHT = (CELL_HEIGHT + 1) * SCALE;
+
+struct Glyph
+{
+  char character;
+  // Top row first, bit 4 is the leftmost column.
+  uint8_t rows[7];
+};
+
+static const Glyph GLYPHS[] = {
+  { '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+  { '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+  { '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+  { '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+  { '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+  { '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+  { '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+  { '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+  { '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+  { '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+  { 'A', { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+  { 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
+  { 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
+  { 'D', { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C } },
+  { 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } },
+  { 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+  { 'G', { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F } },
+  { 'H', { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+  { 'I', { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+  { 'J', { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C } },
+  { 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
+  { 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
+  { 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+  { 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+  { 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+  { 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+  { 'Q', { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D } },
+  { 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+  { 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } },
+  { 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+  { 'U', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+  { 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 } },
+  { 'W', { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A } },
+  { 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+  { 'Y', { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 } },
+  { 'Z', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F } },
+  { '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+  { ',', { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 } },
+  { ':', { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 } },
+  { '/', { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 } },
+  { '%', { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 } },
+  { '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+  { '+', { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 } },
+  { '=', { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 } },
+  { '(', { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 } },
+  { ')', { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 } },
+  { '[', { 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E } },
+  { ']', { 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E } },
+  { '<', { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 } },
+  { '>', { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 } },
+  { '|', { 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+  { '_', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F } },
+  { '?', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 } },
+};
+
+// Bytes in memory order, matches the normalized unsigned byte attribute.
+static constexpr uint32_t rgba(uint32_t p_r, uint32_t p_g, uint32_t p_b, uint32_t p_a)
+{
+  return p_r | p_g << 8 | p_b << 16 | p_a << 24;
+}
+
+static constexpr uint32_t COLOR_BACKDROP = rgba(0, 0, 0, 160);
+static constexpr uint32_t COLOR_TEXT = rgba(255, 255, 255, 255);
+static constexpr uint32_t COLOR_DIM = rgba(170, 170, 170, 255);
+static constexpr uint32_t COLOR_GOOD = rgba(80, 220, 80, 255);
+static constexpr uint32_t COLOR_SLOW = rgba(240, 200, 60, 255);
+static constexpr uint32_t COLOR_BAD = rgba(240, 70, 60, 255);
+
+void GpuTimer::init()
+{
+  glGenQueries(QUERY_COUNT, queries);
+}
+
+void GpuTimer::destroy()
+{
+  if (running) glEndQuery(GL_TIME_ELAPSED);
+  glDeleteQueries(QUERY_COUNT, queries);
+  running = false;
+}
+
+void GpuTimer::begin()
+{
+  // The query we are about to reuse was issued QUERY_COUNT frames ago. If the
+  // GPU is that far behind skip this frame's measurement instead of waiting.
+  if (pending[index])
+  {
+    GLint available = 0;
+    glGetQueryObjectiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) return;
+
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &nanoseconds);
+    last_ms = nanoseconds / 1e6f;
+    pending[index] = false;
+  }
+
+  glBeginQuery(GL_TIME_ELAPSED, queries[index]);
+  running = true;
+}
+
+void GpuTimer::end()
+{
+  if (!running) return;
+  glEndQuery(GL_TIME_ELAPSED);
+  pending[index] = true;
+  running = false;
+  index = (index + 1) % QUERY_COUNT;
+}
+
+void PerfHud::init(GLStateCache& p_state, unsigned int p_program, float p_screen_width, float p_screen_height)
+{
+  program = p_program;
+  p_state.use_program(program);
+  glUniform2f(glGetUniformLocation(program, "u_screen_size"), p_screen_width, p_screen_height);
+  glUniform1i(glGetUniformLocation(program, "u_atlas"), 0);
+
+  const int width = CELL_WIDTH * ATLAS_COLUMNS;
+  const int height = CELL_HEIGHT * ATLAS_ROWS;
+  std::vector<uint8_t> texels(width * height, 0);
+  auto fill_cell = [&](uint32_t p_character, const uint8_t* p_rows)
+  {
+    int cell = (int)p_character - 32;
+    int origin_x = cell % ATLAS_COLUMNS * CELL_WIDTH;
+    int origin_y = cell / ATLAS_COLUMNS * CELL_HEIGHT;
+    for (int y = 0; y < CELL_HEIGHT; ++y)
+    {
+      for (int x = 0; x < CELL_WIDTH; ++x)
+      {
+        bool set = p_rows ? y < 7 && x < 5 && (p_rows[y] >> (4 - x) & 1) : true;
+        texels[(origin_y + y) * width + origin_x + x] = set ? 255 : 0;
+      }
+    }
+  };
+  for (const Glyph& glyph : GLYPHS)
+  {
+    fill_cell(glyph.character, glyph.rows);
+    if (glyph.character >= 'A' && glyph.character <= 'Z') fill_cell(glyph.character - 'A' + 'a', glyph.rows);
+  }
+  fill_cell(SOLID_GLYPH, nullptr);
+
+  glGenTextures(1, &atlas);
+  p_state.bind_texture(0, GL_TEXTURE_2D, atlas);
+  p_state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+  instances.init(p_state, GL_ARRAY_BUFFER, MAX_QUADS * sizeof(Quad) * 3);
+
+  // Attribute pointers are set per draw since the ring offset moves.
+  glGenVertexArrays(1, &vao);
+  p_state.bind_vertex_array(vao);
+  for (GLuint attribute = 0; attribute < 3; ++attribute)
+  {
+    glEnableVertexAttribArray(attribute);
+    glVertexAttribDivisor(attribute, 1);
+  }
+
+  quads.reserve(MAX_QUADS);
+}
+
+void PerfHud::destroy()
+{
+  glDeleteVertexArrays(1, &vao);
+  glDeleteTextures(1, &atlas);
+  instances.destroy();
+}
+
+void PerfHud::record(const PerfHudStats& p_stats)
+{
+  last = p_stats;
+  frame_history[history_next] = p_stats.frame_ms;
+  history_next = (history_next + 1) % GRAPH_FRAMES;
+}
+
+void PerfHud::add_rect(float p_x, float p_y, float p_width, float p_height, uint32_t p_color)
+{
+  if (quads.size() < MAX_QUADS) quads.push_back({ p_x, p_y, p_width, p_height, SOLID_GLYPH, p_color });
+}
+
+void PerfHud::add_text(float p_x, float p_y, const char* p_text, uint32_t p_color)
+{
+  for (const char* c = p_text; *c != '\0' && quads.size() < MAX_QUADS; ++c)
+  {
+    // Spaces and characters outside the atlas only advance.
+    if (*c > ' ' && *c < (char)SOLID_GLYPH) quads.push_back({ p_x, p_y, CELL_WIDTH * SCALE, CELL_HEIGHT * SCALE, (uint32_t)*c, p_color });
+    p_x += CELL_WIDTH * SCALE;
+  }
+}
+
+void PerfHud::draw(GLStateCache& p_state)
+{
+  const float margin = 8.0f;
+  const float padding = 6.0f;
+  const float graph_height = 60.0f;
+  const float bar_width = 3.0f;
+  // Graph pixels per millisecond, 30 ms fills it.
+  const float graph_scale = graph_height / 30.0f;
+  const float target_ms = 1000.0f / 60.0f;
+
+  quads.clear();
+
+  // Backdrop first, its size is patched once the text is laid out.
+  add_rect(margin, margin, 0.0f, 0.0f, COLOR_BACKDROP);
+  float x = margin + padding;
+  float y = margin + padding;
+  char line[96];
+
+  float fps = last.frame_ms > 0.0f ? 1000.0f / last.frame_ms : 0.0f;
+  snprintf(line, sizeof(line), "FRAME %6.2f MS %5.0f FPS", last.frame_ms, fps);
+  add_text(x, y, line, COLOR_TEXT);
+  y += LINE_HEIGHT;
+
+  if (last.gpu_ms >= 0.0f)
+    snprintf(line, sizeof(line), "CPU SIM %5.2f REN %5.2f GPU %5.2f", last.simulation_ms, last.render_ms, last.gpu_ms);
+  else
+    snprintf(line, sizeof(line), "CPU SIM %5.2f REN %5.2f GPU  --", last.simulation_ms, last.render_ms);
+  add_text(x, y, line, COLOR_TEXT);
+  y += LINE_HEIGHT;
+
+  snprintf(line, sizeof(line), "DRAWS %u TRIS %u", last.draw_calls, last.triangles);
+  add_text(x, y, line, COLOR_TEXT);
+  y += LINE_HEIGHT;
+
+  snprintf(line, sizeof(line), "STATE %u SET %u SKIPPED", last.state_changes, last.state_changes_skipped);
+  add_text(x, y, line, COLOR_TEXT);
+  y += LINE_HEIGHT;
+
+  // MiB per tag, CPU plus estimated GPU. Tags using nothing are left out.
+  for (int tag = 0; tag < MEMORY_TAG_MAX; ++tag)
+  {
+    MemoryStats stats = MemoryTracker::get_stats((MemoryTag)tag);
+    float cpu = stats.cpu_live / 1048576.0f;
+    float gpu = stats.gpu_live / 1048576.0f;
+    if (stats.cpu_live == 0 && stats.gpu_live == 0) continue;
+
+    int length = snprintf(line, sizeof(line), "%-8s %6.1f + %6.1f MB", MemoryTracker::get_tag_name((MemoryTag)tag), cpu, gpu);
+    if (stats.budget != 0 && length > 0 && length < (int)sizeof(line)) snprintf(line + length, sizeof(line) - length, " / %.0f", stats.budget / 1048576.0f);
+    bool over = stats.budget != 0 && stats.cpu_live + stats.gpu_live > stats.budget;
+    add_text(x, y, line, over ? COLOR_BAD : COLOR_DIM);
+    y += LINE_HEIGHT;
+  }
+
+  // Oldest frame on the left, with a line at 60 Hz.
+  y += padding;
+  float graph_bottom = y + graph_height;
+  for (int i = 0; i < GRAPH_FRAMES; ++i)
+  {
+    float ms = frame_history[(history_next + i) % GRAPH_FRAMES];
+    float bar = std::min(ms * graph_scale, graph_height);
+    uint32_t color = ms <= target_ms * 1.05f ? COLOR_GOOD : ms <= target_ms * 2.0f ? COLOR_SLOW : COLOR_BAD;
+    add_rect(x + i * bar_width, graph_bottom - bar, bar_width - 1.0f, bar, color);
+  }
+  add_rect(x, graph_bottom - target_ms * graph_scale, GRAPH_FRAMES * bar_width, 1.0f, COLOR_DIM);
+
+  float width = 0.0f;
+  for (const Quad& quad : quads) width = std::max(width, quad.x + quad.width);
+  quads[0].width = width + padding - margin;
+  quads[0].height = graph_bottom + padding - margin;
+
+  GLintptr offset = 0;
+  void* data = instances.map(p_state, quads.size() * sizeof(Quad), sizeof(Quad), &offset);
+  if (!data) return;
+  memcpy(data, quads.data(), quads.size() * sizeof(Quad));
+  instances.unmap(p_state);
+
+  p_state.use_program(program);
+  p_state.bind_vertex_array(vao);
+  p_state.bind_texture(0, GL_TEXTURE_2D, atlas);
+  p_state.bind_buffer(GL_ARRAY_BUFFER, instances.get_buffer());
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Quad), (void*)offset);
+  glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(Quad), (void*)(offset + offsetof(Quad, glyph)));
+  glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Quad), (void*)(offset + offsetof(Quad, color)));
+
+  // Over everything, blended.
+  p_state.disable(GL_DEPTH_TEST);
+  p_state.enable(GL_BLEND);
+  p_state.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  // Not counted, DRAWS and TRIS are the scene's without the overlay.
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)quads.size());
+
+  p_state.disable(GL_BLEND);
+  p_state.enable(GL_DEPTH_TEST);
+}
+
+void PerfHud::end_frame()
+{
+  instances.fence();
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "./gl_state_cache.h"
+#include "./stream_buffer.h"
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// GPU time of the work between begin() and end(), read back a few frames
+// later so the render thread never waits on the query. Render thread only.
+class GpuTimer
+{
+  public:
+  static constexpr int QUERY_COUNT = 4;
+
+  void init();
+  void destroy();
+
+  void begin();
+  void end();
+
+  // Most recent finished measurement, negative until the first one.
+  float get_ms() const { return last_ms; }
+
+  private:
+  GLuint queries[QUERY_COUNT] {};
+  bool pending[QUERY_COUNT] {};
+  int index = 0;
+  bool running = false;
+  float last_ms = -1.0f;
+};
+
+// Numbers for one frame. Simulation values come with the snapshot, the rest
+// is measured on the render thread.
+struct PerfHudStats
+{
+  // Wall time between simulation frames.
+  float frame_ms = 0.0f;
+  float simulation_ms = 0.0f;
+  float render_ms = 0.0f;
+  // Negative while unknown.
+  float gpu_ms = -1.0f;
+  uint32_t draw_calls = 0;
+  uint32_t triangles = 0;
+  uint32_t state_changes = 0;
+  uint32_t state_changes_skipped = 0;
+};
+
+// Frame time graph, CPU/GPU split, draw statistics and memory per tag,
+// drawn over the scene. Text and graph bars are quads into a built-in 5x7
+// glyph atlas (one cell is solid for bars and the backdrop), written to a
+// stream buffer and drawn with a single instanced strip. Render thread only.
+class PerfHud
+{
+  public:
+  static constexpr int MAX_QUADS = 2048;
+  static constexpr int GRAPH_FRAMES = 120;
+
+  void init(GLStateCache& p_state, unsigned int p_program, float p_screen_width, float p_screen_height);
+  void destroy();
+
+  // Adds a frame to the history, also while hidden so the graph is full
+  // when it is shown.
+  void record(const PerfHudStats& p_stats);
+
+  // Last recorded frame over whatever is in the framebuffer.
+  void draw(GLStateCache& p_state);
+  void end_frame();
+
+  private:
+  struct Quad
+  {
+    // Top left corner and size in pixels.
+    float x, y;
+    float width, height;
+    uint32_t glyph;
+    uint32_t color;
+  };
+
+  void add_rect(float p_x, float p_y, float p_width, float p_height, uint32_t p_color);
+  void add_text(float p_x, float p_y, const char* p_text, uint32_t p_color);
+
+  unsigned int program = 0;
+  GLuint vao = 0;
+  GLuint atlas = 0;
+  StreamBuffer instances;
+
+  std::vector<Quad> quads;
+  PerfHudStats last;
+  float frame_history[GRAPH_FRAMES] {};
+  int history_next = 0;
+};
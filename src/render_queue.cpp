@@ -0,0 +1,127 @@
+#include "./render_queue.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstring>
+
+RenderQueue::RenderQueue(FrameArena& p_arena) :
+    arena(p_arena), packets(ArenaAllocator<DrawPacket> { p_arena })
+{
+  packets.reserve(256);
+}
+
+uint64_t RenderQueue::make_key(uint32_t p_layer, uint32_t p_program, uint32_t p_material, uint32_t p_mesh, float p_depth)
+{
+  const uint32_t depth_max = (1u << DEPTH_BITS) - 1;
+  uint32_t depth = (uint32_t)(glm::clamp(p_depth, 0.0f, 1.0f) * depth_max);
+  if (p_layer == LAYER_TRANSPARENT) depth = depth_max - depth;
+
+  return ((uint64_t)(p_layer & ((1u << LAYER_BITS) - 1)) << LAYER_SHIFT)
+      | ((uint64_t)(p_program & ((1u << PROGRAM_BITS) - 1)) << PROGRAM_SHIFT)
+      | ((uint64_t)(p_material & ((1u << MATERIAL_BITS) - 1)) << MATERIAL_SHIFT)
+      | ((uint64_t)(p_mesh & ((1u << MESH_BITS) - 1)) << MESH_SHIFT)
+      | ((uint64_t)depth << DEPTH_SHIFT);
+}
+
+void RenderQueue::submit(uint64_t p_key, uint32_t p_object)
+{
+  packets.push_back({ p_key, p_object, 0 });
+}
+
+void RenderQueue::sort()
+{
+  size_t count = packets.size();
+  if (count < 2) return;
+
+  // LSD radix sort, 8 bits per pass. All histograms are built in one read
+  // and passes where every key has the same digit are skipped.
+  uint32_t histograms[8][256] = {};
+  for (size_t i = 0; i < count; ++i)
+  {
+    uint64_t key = packets[i].key;
+    for (int pass = 0; pass < 8; ++pass) histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+  }
+
+  DrawPacket* src = packets.data();
+  DrawPacket* dst = arena.allocate_array<DrawPacket>(count);
+
+  for (int pass = 0; pass < 8; ++pass)
+  {
+    int shift = pass * 8;
+    uint32_t* histogram = histograms[pass];
+    if (histogram[(src[0].key >> shift) & 0xFF] == count) continue;
+
+    uint32_t offset = 0;
+    for (int digit = 0; digit < 256; ++digit)
+    {
+      uint32_t digit_count = histogram[digit];
+      histogram[digit] = offset;
+      offset += digit_count;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+    }
+
+    DrawPacket* tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+
+  if (src != packets.data()) memcpy(packets.data(), src, count * sizeof(DrawPacket));
+}
+
+void RenderQueue::execute(GLStateCache& p_state, UniformBuffers& p_uniforms, const DrawPacket* p_packets, size_t p_count, const RenderResources& p_resources)
+{
+  GLsizei counts[MAX_MULTI_DRAW];
+  const void* offsets[MAX_MULTI_DRAW];
+  GLint base_vertices[MAX_MULTI_DRAW];
+
+  // Binds go through the state cache, which drops the ones that repeat
+  // between consecutive packets.
+  size_t i = 0;
+  while (i < p_count)
+  {
+    const DrawPacket& packet = p_packets[i];
+    if (!p_uniforms.bind_object(p_state, packet.object))
+    {
+      i++;
+      continue;
+    }
+
+    uint32_t program = get_field(packet.key, PROGRAM_SHIFT, PROGRAM_BITS);
+    uint32_t material = get_field(packet.key, MATERIAL_SHIFT, MATERIAL_BITS);
+    const MeshDraw& mesh = p_resources.meshes[get_field(packet.key, MESH_SHIFT, MESH_BITS)];
+
+    p_state.use_program(p_resources.programs[program].id);
+    p_state.bind_texture(0, GL_TEXTURE_2D, p_resources.materials[material].texture);
+    p_state.bind_vertex_array(mesh.vao);
+
+    // Gather the following packets that only differ in mesh.
+    GLsizei draw_count = 0;
+    do
+    {
+      const MeshDraw& next = p_resources.meshes[get_field(p_packets[i].key, MESH_SHIFT, MESH_BITS)];
+      counts[draw_count] = (GLsizei)next.geometry.index_count;
+      offsets[draw_count] = (const void*)(next.geometry.first_index * sizeof(uint32_t));
+      base_vertices[draw_count] = next.geometry.base_vertex;
+      draw_count++;
+      i++;
+    } while (i < p_count && draw_count < MAX_MULTI_DRAW
+        && p_packets[i].object == packet.object
+        && get_field(p_packets[i].key, PROGRAM_SHIFT, PROGRAM_BITS) == program
+        && get_field(p_packets[i].key, MATERIAL_SHIFT, MATERIAL_BITS) == material
+        && p_resources.meshes[get_field(p_packets[i].key, MESH_SHIFT, MESH_BITS)].vao == mesh.vao);
+
+    uint32_t triangles = 0;
+    for (GLsizei draw = 0; draw < draw_count; ++draw) triangles += counts[draw] / 3;
+    p_state.count_draw(triangles);
+
+    if (draw_count == 1)
+      glDrawElementsBaseVertex(GL_TRIANGLES, counts[0], GL_UNSIGNED_INT, offsets[0], base_vertices[0]);
+    else
+      glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts, GL_UNSIGNED_INT, offsets, draw_count, base_vertices);
+  }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "./frame_arena.h"
+#include "./geometry_pool.h"
+#include "./gl_state_cache.h"
+#include "./uniform_buffers.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compact draw request. Everything needed to order and issue the draw is in
+// the key, object indexes into the snapshot's RenderObject array (and so into
+// the per-object uniform data).
+struct DrawPacket
+{
+  uint64_t key;
+  uint32_t object;
+  uint32_t pad;
+};
+
+// Uniforms come from the shared UBO bindings and samplers are assigned at
+// link time, so a program needs no per-frame setup.
+struct ShaderProgram
+{
+  unsigned int id = 0;
+};
+
+struct MaterialDraw
+{
+  unsigned int texture = 0;
+};
+
+// Meshes normally all live in the same GeometryPool VAO.
+struct MeshDraw
+{
+  unsigned int vao = 0;
+  GeometryRange geometry;
+};
+
+// GL objects referenced by the ids packed into sort keys. Filled during setup
+// and only read by the render thread afterwards.
+struct RenderResources
+{
+  std::vector<ShaderProgram> programs;
+  std::vector<MaterialDraw> materials;
+  std::vector<MeshDraw> meshes;
+};
+
+// Draw packets for one frame, allocated from the frame arena. Keys sort by
+// layer, then shader, material, mesh and finally depth, so sorting groups
+// draws that share state and execute() only rebinds what changed.
+class RenderQueue
+{
+  public:
+  enum Layer
+  {
+    LAYER_OPAQUE,
+    LAYER_TRANSPARENT,
+    LAYER_OVERLAY,
+  };
+
+  // Bit layout, most significant first.
+  static constexpr int LAYER_BITS = 8;
+  static constexpr int PROGRAM_BITS = 8;
+  static constexpr int MATERIAL_BITS = 12;
+  static constexpr int MESH_BITS = 12;
+  static constexpr int DEPTH_BITS = 24;
+
+  static constexpr int DEPTH_SHIFT = 0;
+  static constexpr int MESH_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+  static constexpr int MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+  static constexpr int PROGRAM_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+  static constexpr int LAYER_SHIFT = PROGRAM_SHIFT + PROGRAM_BITS;
+
+  explicit RenderQueue(FrameArena& p_arena);
+
+  // p_depth is the normalized view depth in [0, 1]. Transparent draws sort
+  // back to front, everything else front to back.
+  static uint64_t make_key(uint32_t p_layer, uint32_t p_program, uint32_t p_material, uint32_t p_mesh, float p_depth);
+
+  static uint32_t get_field(uint64_t p_key, int p_shift, int p_bits)
+  {
+    return (uint32_t)((p_key >> p_shift) & ((1ull << p_bits) - 1));
+  }
+
+  void submit(uint64_t p_key, uint32_t p_object);
+  void sort();
+
+  const DrawPacket* get_packets() const { return packets.data(); }
+  size_t get_packet_count() const { return packets.size(); }
+
+  // Consecutive packets with the same program, material, VAO and object are
+  // merged into one multi-draw. Render thread only.
+  static constexpr int MAX_MULTI_DRAW = 64;
+
+  static void execute(GLStateCache& p_state, UniformBuffers& p_uniforms, const DrawPacket* p_packets, size_t p_count, const RenderResources& p_resources);
+
+  private:
+  FrameArena& arena;
+  FrameVector<DrawPacket> packets;
+};
@@ -0,0 +1,76 @@
+#include "./render_thread.h"
+
+#include "./memory_tracker.h"
+
+#include <iostream>
+
+RenderThread::~RenderThread()
+{
+  stop();
+}
+
+void RenderThread::start(SDL_Window* p_window, SDL_GLContext p_context, RenderFunc p_render_func)
+{
+  window = p_window;
+  context = p_context;
+  render_func = std::move(p_render_func);
+  running = true;
+  thread = std::thread { &RenderThread::run, this };
+}
+
+void RenderThread::submit(const RenderSnapshot& p_snapshot)
+{
+  std::unique_lock<std::mutex> lock { mutex };
+  condition.wait(lock, [this] { return (!has_pending && !rendering) || !running; });
+
+  pending = p_snapshot;
+  has_pending = true;
+  condition.notify_all();
+}
+
+void RenderThread::stop()
+{
+  if (!thread.joinable()) return;
+
+  {
+    std::lock_guard<std::mutex> lock { mutex };
+    running = false;
+  }
+  condition.notify_all();
+  thread.join();
+}
+
+void RenderThread::run()
+{
+  MemoryTracker::set_thread_tag(MEMORY_TAG_RENDER);
+
+  if (!SDL_GL_MakeCurrent(window, context))
+  {
+    std::cerr << "ERROR::RENDER_THREAD::MAKE_CURRENT_FAILED " << SDL_GetError() << std::endl;
+  }
+
+  while (true)
+  {
+    RenderSnapshot snapshot;
+    {
+      std::unique_lock<std::mutex> lock { mutex };
+      condition.wait(lock, [this] { return has_pending || !running; });
+      if (!running) break;
+
+      snapshot = pending;
+      has_pending = false;
+      rendering = true;
+    }
+
+    render_func(snapshot);
+    SDL_GL_SwapWindow(window);
+
+    {
+      std::lock_guard<std::mutex> lock { mutex };
+      rendering = false;
+    }
+    condition.notify_all();
+  }
+
+  SDL_GL_MakeCurrent(window, nullptr);
+}
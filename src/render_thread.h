@@ -0,0 +1,87 @@
+#pragma once
+
+#include "./particle_system.h"
+#include "./render_queue.h"
+#include "./texture_streamer.h"
+
+#include <SDL3/SDL.h>
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+struct RenderObject
+{
+  glm::mat4 model;
+  glm::vec4 color { 1.0f };
+};
+
+// Everything the render thread needs to draw one frame. Built by the
+// simulation and never modified after submit(), arrays live in the frame
+// arena of the frame that produced it.
+struct RenderSnapshot
+{
+  uint64_t frame = 0;
+  float time = 0.0f;
+  float delta = 0.0f;
+  glm::mat4 view { 1.0f };
+  glm::mat4 projection { 1.0f };
+  const RenderObject* objects = nullptr;
+  size_t object_count = 0;
+
+  // Sorted, see RenderQueue.
+  const DrawPacket* packets = nullptr;
+  size_t packet_count = 0;
+
+  const ParticleInstance* particles = nullptr;
+  size_t particle_count = 0;
+
+  // Spawned and simulated on the GPU, see GpuParticles.
+  const ParticleBurst* gpu_bursts = nullptr;
+  size_t gpu_burst_count = 0;
+
+  // Screen-space usage of streamed textures, see TextureStreamer.
+  const TextureRequest* texture_requests = nullptr;
+  size_t texture_request_count = 0;
+
+  // Simulation timings for the perf HUD, see PerfHud.
+  bool show_perf_hud = false;
+  float frame_ms = 0.0f;
+  float simulation_ms = 0.0f;
+};
+
+// Owns the GL context and draws snapshots handed over by the simulation, one
+// frame behind it. submit() for frame N blocks until frame N - 1 has been
+// drawn and swapped, which is also what makes it safe to reuse frame N - 1's
+// arena for frame N + 1.
+class RenderThread
+{
+  public:
+  using RenderFunc = std::function<void(const RenderSnapshot&)>;
+
+  ~RenderThread();
+
+  // The context must not be current on the calling thread.
+  void start(SDL_Window* p_window, SDL_GLContext p_context, RenderFunc p_render_func);
+  void submit(const RenderSnapshot& p_snapshot);
+  void stop();
+
+  private:
+  void run();
+
+  SDL_Window* window = nullptr;
+  SDL_GLContext context = nullptr;
+  RenderFunc render_func;
+
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable condition;
+  RenderSnapshot pending;
+  bool has_pending = false;
+  bool rendering = false;
+  bool running = false;
+};
@@ -0,0 +1,222 @@
+#include "./resource_manager.h"
+
+#include "./memory_tracker.h"
+#include "./mesh_loader.h"
+#include "./shader.h"
+#include "./texture_cooker.h"
+#include "./utils.h"
+
+#include <iostream>
+
+ResourceManager::ResourceManager(GeometryPool& p_geometry, TextureStreamer& p_textures) :
+    geometry(p_geometry),
+    streamer(p_textures)
+{
+}
+
+MeshHandle ResourceManager::load_mesh(GLStateCache& p_state, const std::string& p_path)
+{
+  MemoryScope memory_scope { MEMORY_TAG_ASSETS };
+  uint64_t key = Utils::hash_string(p_path);
+  {
+    std::lock_guard<std::mutex> lock { mutex };
+    MeshHandle existing = meshes.find(key);
+    if (existing.is_valid()) return existing;
+  }
+
+  MeshData data = MeshLoader::load(p_path);
+  if (data.indices.empty())
+  {
+    std::cerr << "ERROR::RESOURCE_MANAGER::MESH_LOAD_FAILED " << p_path << std::endl;
+    return MeshHandle {};
+  }
+
+  MeshResource mesh;
+  mesh.geometry = geometry.add(p_state, data.positions.data(), data.tex_coords.data(), (uint32_t)(data.positions.size() / 3), data.indices.data(), (uint32_t)data.indices.size());
+  mesh.bounds_min = data.bounds_min;
+  mesh.bounds_max = data.bounds_max;
+  mesh.bounds_center = data.bounds_center;
+  mesh.bounds_radius = data.bounds_radius;
+  if (!data.pixels.empty())
+  {
+    mesh.texture = load_texture(p_state, data.image_source, data.pixels.data(), data.image_width, data.image_height, data.image_components);
+  }
+
+  MeshHandle existing;
+  {
+    std::lock_guard<std::mutex> lock { mutex };
+    existing = meshes.find(key);
+    if (!existing.is_valid()) return meshes.insert(key, mesh);
+
+    // Another thread loaded the same path meanwhile. Keep theirs, this copy
+    // goes through the normal delayed delete.
+    PendingDelete entry {};
+    entry.type = PendingDelete::MESH;
+    entry.mesh = mesh;
+    pending.push_back(entry);
+  }
+  if (mesh.texture.is_valid()) release(mesh.texture);
+  return existing;
+}
+
+TextureHandle ResourceManager::load_texture(GLStateCache& p_state, const std::string& p_source_path, const unsigned char* p_pixels, uint32_t p_width, uint32_t p_height, int p_components)
+{
+  MemoryScope memory_scope { MEMORY_TAG_ASSETS };
+  uint64_t key = Utils::hash_string(p_source_path);
+  {
+    std::lock_guard<std::mutex> lock { mutex };
+    TextureHandle existing = textures.find(key);
+    if (existing.is_valid()) return existing;
+  }
+
+  // BC compressed from the cooked cache where supported, plain otherwise.
+  TextureData data;
+  if (GLEW_EXT_texture_compression_s3tc)
+    data = TextureCooker::cook(p_source_path, "../res/cache", p_pixels, p_width, p_height, p_components);
+  else
+    data = TextureCooker::build_mips(p_pixels, p_width, p_height, p_components);
+
+  TextureResource texture;
+  texture.streamer_slot = streamer.add(p_state, std::move(data));
+  texture.texture = streamer.get_gl_texture(texture.streamer_slot);
+
+  std::lock_guard<std::mutex> lock { mutex };
+  TextureHandle existing = textures.find(key);
+  if (!existing.is_valid()) return textures.insert(key, texture);
+
+  // Lost a race with another load of the same path, see load_mesh().
+  PendingDelete entry {};
+  entry.type = PendingDelete::TEXTURE;
+  entry.texture = texture;
+  pending.push_back(entry);
+  return existing;
+}
+
+ProgramHandle ResourceManager::load_program(const std::string& p_vert_path, const std::string& p_frag_path)
+{
+  MemoryScope memory_scope { MEMORY_TAG_ASSETS };
+  uint64_t key = Utils::hash_string(p_vert_path + "|" + p_frag_path);
+  {
+    std::lock_guard<std::mutex> lock { mutex };
+    ProgramHandle existing = programs.find(key);
+    if (existing.is_valid()) return existing;
+  }
+
+  ProgramResource program;
+  program.program = Shader::load_program(p_vert_path.c_str(), p_frag_path.c_str());
+
+  std::lock_guard<std::mutex> lock { mutex };
+  ProgramHandle existing = programs.find(key);
+  if (!existing.is_valid()) return programs.insert(key, program);
+
+  // Lost a race with another load of the same path, see load_mesh().
+  PendingDelete entry {};
+  entry.type = PendingDelete::PROGRAM;
+  entry.program = program;
+  pending.push_back(entry);
+  return existing;
+}
+
+void ResourceManager::add_ref(MeshHandle p_handle)
+{
+  std::lock_guard<std::mutex> lock { mutex };
+  if (meshes.get(p_handle) != nullptr) meshes.slots[p_handle.index].ref_count++;
+}
+
+bool ResourceManager::get(MeshHandle p_handle, MeshResource& r_out) const
+{
+  std::lock_guard<std::mutex> lock { mutex };
+  const MeshResource* resource = meshes.get(p_handle);
+  if (resource == nullptr) return false;
+  r_out = *resource;
+  return true;
+}
+
+bool ResourceManager::get(TextureHandle p_handle, TextureResource& r_out) const
+{
+  std::lock_guard<std::mutex> lock { mutex };
+  const TextureResource* resource = textures.get(p_handle);
+  if (resource == nullptr) return false;
+  r_out = *resource;
+  return true;
+}
+
+bool ResourceManager::get(ProgramHandle p_handle, ProgramResource& r_out) const
+{
+  std::lock_guard<std::mutex> lock { mutex };
+  const ProgramResource* resource = programs.get(p_handle);
+  if (resource == nullptr) return false;
+  r_out = *resource;
+  return true;
+}
+
+void ResourceManager::release(MeshHandle p_handle)
+{
+  TextureHandle texture;
+  {
+    std::lock_guard<std::mutex> lock { mutex };
+    PendingDelete entry {};
+    entry.type = PendingDelete::MESH;
+    if (!meshes.release(p_handle, &entry.mesh)) return;
+    texture = entry.mesh.texture;
+    pending.push_back(entry);
+  }
+
+  // The mesh held a reference to its texture.
+  if (texture.is_valid()) release(texture);
+}
+
+void ResourceManager::release(TextureHandle p_handle)
+{
+  std::lock_guard<std::mutex> lock { mutex };
+  PendingDelete entry {};
+  entry.type = PendingDelete::TEXTURE;
+  if (textures.release(p_handle, &entry.texture)) pending.push_back(entry);
+}
+
+void ResourceManager::release(ProgramHandle p_handle)
+{
+  std::lock_guard<std::mutex> lock { mutex };
+  PendingDelete entry {};
+  entry.type = PendingDelete::PROGRAM;
+  if (programs.release(p_handle, &entry.program)) pending.push_back(entry);
+}
+
+void ResourceManager::collect(GLStateCache& p_state)
+{
+  std::lock_guard<std::mutex> lock { mutex };
+
+  size_t kept = 0;
+  bool deleted = false;
+  for (PendingDelete& entry : pending)
+  {
+    if (entry.frame == 0) entry.frame = frame;
+    if (frame < entry.frame + DELETE_DELAY)
+    {
+      pending[kept++] = entry;
+      continue;
+    }
+
+    switch (entry.type)
+    {
+      case PendingDelete::MESH:
+        geometry.free(entry.mesh.geometry);
+        break;
+      case PendingDelete::TEXTURE:
+        streamer.remove(entry.texture.streamer_slot);
+        deleted = true;
+        break;
+      case PendingDelete::PROGRAM:
+        glDeleteProgram(entry.program.program);
+        deleted = true;
+        break;
+    }
+  }
+  pending.resize(kept);
+
+  // Deleting unbinds behind the cache's back, and GL may hand the same id
+  // out again.
+  if (deleted) p_state.invalidate();
+
+  frame++;
+}
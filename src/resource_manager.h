@@ -0,0 +1,205 @@
+#pragma once
+
+#include "./geometry_pool.h"
+#include "./gl_state_cache.h"
+#include "./texture_streamer.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Index into a ResourceManager table plus the generation of the slot when
+// the handle was made. A handle to a released slot, even one reused since,
+// resolves to null. Generation 0 is never handed out, so a default handle is
+// invalid.
+template <typename T>
+struct Handle
+{
+  uint32_t index = 0;
+  uint32_t generation = 0;
+
+  bool is_valid() const { return generation != 0; }
+  bool operator==(const Handle& p_other) const { return index == p_other.index && generation == p_other.generation; }
+  bool operator!=(const Handle& p_other) const { return !(*this == p_other); }
+};
+
+struct TextureResource
+{
+  // Slot in the TextureStreamer.
+  uint32_t streamer_slot = 0;
+  GLuint texture = 0;
+};
+
+struct MeshResource
+{
+  GeometryRange geometry;
+  Handle<TextureResource> texture;
+
+  // Local space bounds, for culling.
+  glm::vec3 bounds_min { 0.0f };
+  glm::vec3 bounds_max { 0.0f };
+  glm::vec3 bounds_center { 0.0f };
+  float bounds_radius = 0.0f;
+};
+
+struct ProgramResource
+{
+  GLuint program = 0;
+};
+
+using TextureHandle = Handle<TextureResource>;
+using MeshHandle = Handle<MeshResource>;
+using ProgramHandle = Handle<ProgramResource>;
+
+// Loads meshes, textures and programs once per path and hands out reference
+// counted handles. Loading a path that is already resident only bumps its
+// count. When the count drops to zero the GPU objects are queued and only
+// deleted a couple of frames later by collect(), since snapshots already
+// handed to the render thread may still draw with them.
+// Loads and collect() need the GL context; release() and get() may come
+// from any thread.
+class ResourceManager
+{
+  public:
+  // Frames a released resource stays alive, one for the snapshot being
+  // built and one for the one being drawn.
+  static constexpr uint64_t DELETE_DELAY = 2;
+
+  ResourceManager(GeometryPool& p_geometry, TextureStreamer& p_textures);
+
+  MeshHandle load_mesh(GLStateCache& p_state, const std::string& p_path);
+  ProgramHandle load_program(const std::string& p_vert_path, const std::string& p_frag_path);
+
+  // p_source_path keys deduplication and the cooked cache, the pixels are
+  // only read if it isn't loaded yet.
+  TextureHandle load_texture(GLStateCache& p_state, const std::string& p_source_path, const unsigned char* p_pixels, uint32_t p_width, uint32_t p_height, int p_components);
+
+  // Extra reference, e.g. when a second owner keeps a handle around.
+  void add_ref(MeshHandle p_handle);
+
+  void release(MeshHandle p_handle);
+  void release(TextureHandle p_handle);
+  void release(ProgramHandle p_handle);
+
+  // Copies the resource out under the lock, since a release on another
+  // thread may reuse the slot right after. False for stale handles.
+  bool get(MeshHandle p_handle, MeshResource& r_out) const;
+  bool get(TextureHandle p_handle, TextureResource& r_out) const;
+  bool get(ProgramHandle p_handle, ProgramResource& r_out) const;
+
+  // Deletes whatever was released at least DELETE_DELAY frames ago. Once per
+  // frame on the render thread.
+  void collect(GLStateCache& p_state);
+
+  size_t get_pending_delete_count() const
+  {
+    std::lock_guard<std::mutex> lock { mutex };
+    return pending.size();
+  }
+
+  private:
+  template <typename T>
+  struct Table
+  {
+    struct Slot
+    {
+      T resource;
+      uint32_t generation = 1;
+      uint32_t ref_count = 0;
+      uint64_t key = 0;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> free_slots;
+    std::unordered_map<uint64_t, uint32_t> by_key;
+
+    // Caller holds the mutex.
+    const T* get(Handle<T> p_handle) const
+    {
+      if (p_handle.index >= slots.size()) return nullptr;
+      const Slot& slot = slots[p_handle.index];
+      return slot.generation == p_handle.generation && slot.ref_count > 0 ? &slot.resource : nullptr;
+    }
+
+    // Existing handle with one more reference, or an invalid one.
+    Handle<T> find(uint64_t p_key)
+    {
+      auto it = by_key.find(p_key);
+      if (it == by_key.end()) return Handle<T> {};
+      Slot& slot = slots[it->second];
+      slot.ref_count++;
+      return Handle<T> { it->second, slot.generation };
+    }
+
+    Handle<T> insert(uint64_t p_key, const T& p_resource)
+    {
+      uint32_t index;
+      if (!free_slots.empty())
+      {
+        index = free_slots.back();
+        free_slots.pop_back();
+      }
+      else
+      {
+        index = (uint32_t)slots.size();
+        slots.emplace_back();
+      }
+
+      Slot& slot = slots[index];
+      slot.resource = p_resource;
+      slot.ref_count = 1;
+      slot.key = p_key;
+      by_key[p_key] = index;
+      return Handle<T> { index, slot.generation };
+    }
+
+    // True if this dropped the last reference. The slot is retired right
+    // away, so the handle goes stale before the GPU data is deleted.
+    bool release(Handle<T> p_handle, T* r_resource)
+    {
+      if (get(p_handle) == nullptr) return false;
+      Slot& slot = slots[p_handle.index];
+      if (--slot.ref_count > 0) return false;
+
+      *r_resource = slot.resource;
+      by_key.erase(slot.key);
+      slot.generation++;
+      if (slot.generation == 0) slot.generation = 1;
+      free_slots.push_back(p_handle.index);
+      return true;
+    }
+  };
+
+  struct PendingDelete
+  {
+    enum Type
+    {
+      MESH,
+      TEXTURE,
+      PROGRAM,
+    };
+
+    Type type;
+    // 0 until collect() first sees it.
+    uint64_t frame;
+    MeshResource mesh;
+    TextureResource texture;
+    ProgramResource program;
+  };
+
+  GeometryPool& geometry;
+  TextureStreamer& streamer;
+
+  Table<MeshResource> meshes;
+  Table<TextureResource> textures;
+  Table<ProgramResource> programs;
+
+  mutable std::mutex mutex;
+  std::vector<PendingDelete> pending;
+  uint64_t frame = 1;
+};
@@ -0,0 +1,71 @@
+#include "./shader.h"
+#include "./utils.h"
+
+#include <GL/glew.h>
+
+#include <iostream>
+#include <string>
+
+static unsigned int compile_shader(const char* p_filepath, unsigned int p_type, const char* p_type_name)
+{
+  int success;
+  char info_log[512];
+
+  std::string source_string = Utils::load_file_source(p_filepath);
+  const char* source = source_string.c_str();
+  unsigned int shader = glCreateShader(p_type);
+  glShaderSource(shader, 1, &source, nullptr);
+  glCompileShader(shader);
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+  if (!success)
+  {
+    glGetShaderInfoLog(shader, 512, nullptr, info_log);
+    std::cerr << "ERROR::SHADER::" << p_type_name << "::COMPILATION_FAILED " << p_filepath << std::endl;
+    std::cerr << info_log << std::endl;
+  }
+  return shader;
+}
+
+static void check_link(unsigned int p_program)
+{
+  int success;
+  char info_log[512];
+
+  glGetProgramiv(p_program, GL_LINK_STATUS, &success);
+  if (!success)
+  {
+    glGetProgramInfoLog(p_program, 512, nullptr, info_log);
+    std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED" << std::endl;
+    std::cerr << info_log << std::endl;
+  }
+}
+
+unsigned int Shader::load_program(const char* p_vert_path, const char* p_frag_path)
+{
+  unsigned int vert_shader = compile_shader(p_vert_path, GL_VERTEX_SHADER, "VERTEX");
+  unsigned int frag_shader = compile_shader(p_frag_path, GL_FRAGMENT_SHADER, "FRAGMENT");
+
+  unsigned int program = glCreateProgram();
+  glAttachShader(program, vert_shader);
+  glAttachShader(program, frag_shader);
+  glLinkProgram(program);
+  check_link(program);
+
+  glDeleteShader(vert_shader);
+  glDeleteShader(frag_shader);
+  return program;
+}
+
+unsigned int Shader::load_feedback_program(const char* p_vert_path, const char* const* p_varyings, int p_varying_count)
+{
+  unsigned int vert_shader = compile_shader(p_vert_path, GL_VERTEX_SHADER, "VERTEX");
+
+  unsigned int program = glCreateProgram();
+  glAttachShader(program, vert_shader);
+  glTransformFeedbackVaryings(program, p_varying_count, p_varyings, GL_INTERLEAVED_ATTRIBS);
+  glLinkProgram(program);
+  check_link(program);
+
+  glDeleteShader(vert_shader);
+  return program;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+class Shader
+{
+  public:
+  // Compiles and links a vertex/fragment pair, errors are logged. Returns the
+  // program even if it failed, like glCreateProgram would.
+  static unsigned int load_program(const char* p_vert_path, const char* p_frag_path);
+
+  // Vertex-only program whose p_varyings are captured interleaved with
+  // transform feedback. Rasterization should be discarded while it runs.
+  static unsigned int load_feedback_program(const char* p_vert_path, const char* const* p_varyings, int p_varying_count);
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+// Thin wrapper over the widest float SIMD available at compile time, so
+// kernels are written once: AVX (8 wide), SSE or NEON (4 wide), or scalar
+// (SIMD_WIDTH 1, kernels fall back to their plain loops).
+
+#if defined(__AVX__) || defined(__SSE2__)
+  #include <immintrin.h>
+#elif defined(__ARM_NEON)
+  #include <arm_neon.h>
+#endif
+
+#include <cstdint>
+
+#if defined(__AVX__)
+  #define SIMD_WIDTH 8
+typedef __m256 vfloat;
+static inline vfloat v_load(const float* p) { return _mm256_loadu_ps(p); }
+static inline void v_store(float* p, vfloat a) { _mm256_storeu_ps(p, a); }
+static inline vfloat v_set(float v) { return _mm256_set1_ps(v); }
+static inline vfloat v_add(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+static inline vfloat v_sub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+static inline vfloat v_mul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+static inline vfloat v_min(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+static inline vfloat v_max(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+static inline vfloat v_and(vfloat a, vfloat b) { return _mm256_and_ps(a, b); }
+static inline vfloat v_gt(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+static inline int v_mask(vfloat a) { return _mm256_movemask_ps(a); }
+#elif defined(__SSE2__)
+  #define SIMD_WIDTH 4
+typedef __m128 vfloat;
+static inline vfloat v_load(const float* p) { return _mm_loadu_ps(p); }
+static inline void v_store(float* p, vfloat a) { _mm_storeu_ps(p, a); }
+static inline vfloat v_set(float v) { return _mm_set1_ps(v); }
+static inline vfloat v_add(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+static inline vfloat v_sub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+static inline vfloat v_mul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+static inline vfloat v_min(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+static inline vfloat v_max(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+static inline vfloat v_and(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+static inline vfloat v_gt(vfloat a, vfloat b) { return _mm_cmpgt_ps(a, b); }
+static inline int v_mask(vfloat a) { return _mm_movemask_ps(a); }
+#elif defined(__ARM_NEON)
+  #define SIMD_WIDTH 4
+typedef float32x4_t vfloat;
+static inline vfloat v_load(const float* p) { return vld1q_f32(p); }
+static inline void v_store(float* p, vfloat a) { vst1q_f32(p, a); }
+static inline vfloat v_set(float v) { return vdupq_n_f32(v); }
+static inline vfloat v_add(vfloat a, vfloat b) { return vaddq_f32(a, b); }
+static inline vfloat v_sub(vfloat a, vfloat b) { return vsubq_f32(a, b); }
+static inline vfloat v_mul(vfloat a, vfloat b) { return vmulq_f32(a, b); }
+static inline vfloat v_min(vfloat a, vfloat b) { return vminq_f32(a, b); }
+static inline vfloat v_max(vfloat a, vfloat b) { return vmaxq_f32(a, b); }
+static inline vfloat v_and(vfloat a, vfloat b) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+static inline vfloat v_gt(vfloat a, vfloat b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+static inline int v_mask(vfloat a)
+{
+  static const int32_t shifts[4] = { 0, 1, 2, 3 };
+  uint32x4_t bits = vshrq_n_u32(vreinterpretq_u32_f32(a), 31);
+  return (int)vaddvq_u32(vshlq_u32(bits, vld1q_s32(shifts)));
+}
+#else
+  #define SIMD_WIDTH 1
+#endif
@@ -0,0 +1,125 @@
+#include "./stream_buffer.h"
+
+#include "./memory_tracker.h"
+
+#include <iostream>
+
+void StreamBuffer::init(GLStateCache& p_state, GLenum p_target, GLsizeiptr p_size)
+{
+  target = p_target;
+  size = p_size;
+  free_until = size;
+
+  glGenBuffers(1, &buffer);
+  p_state.bind_buffer(target, buffer);
+
+  if (GLEW_ARB_buffer_storage)
+  {
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(target, size, nullptr, flags);
+    persistent_data = static_cast<unsigned char*>(glMapBufferRange(target, 0, size, flags));
+    if (!persistent_data) std::cerr << "WARNING::STREAM_BUFFER::PERSISTENT_MAP_FAILED" << std::endl;
+  }
+  else
+  {
+    glBufferData(target, size, nullptr, GL_STREAM_DRAW);
+  }
+  MemoryTracker::add_gpu(MEMORY_TAG_RENDER, size);
+}
+
+void StreamBuffer::destroy()
+{
+  for (int i = 0; i < fence_count; ++i)
+  {
+    glDeleteSync(fences[(fence_first + i) % MAX_FENCES].sync);
+  }
+  fence_count = 0;
+
+  if (persistent_data)
+  {
+    glBindBuffer(target, buffer);
+    glUnmapBuffer(target);
+    persistent_data = nullptr;
+  }
+  glDeleteBuffers(1, &buffer);
+  buffer = 0;
+  MemoryTracker::remove_gpu(MEMORY_TAG_RENDER, size);
+}
+
+void StreamBuffer::wait_until_free(uint64_t p_position)
+{
+  while (free_until < p_position && fence_count > 0)
+  {
+    Fence& oldest = fences[fence_first];
+    GLenum result = glClientWaitSync(oldest.sync, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+      // The GPU is a whole ring behind, this is the only place we stall.
+      result = glClientWaitSync(oldest.sync, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+    }
+    if (result == GL_WAIT_FAILED) std::cerr << "ERROR::STREAM_BUFFER::WAIT_FAILED" << std::endl;
+
+    glDeleteSync(oldest.sync);
+    free_until = oldest.end + size;
+    fence_first = (fence_first + 1) % MAX_FENCES;
+    fence_count--;
+  }
+}
+
+void* StreamBuffer::map(GLStateCache& p_state, GLsizeiptr p_size, GLsizeiptr p_alignment, GLintptr* r_offset)
+{
+  if (p_size > size) return nullptr;
+
+  uint64_t position = (head + p_alignment - 1) / p_alignment * p_alignment;
+  GLsizeiptr offset = position % size;
+  if (offset + p_size > size)
+  {
+    // Doesn't fit before the end, skip to the start of the ring.
+    position += size - offset;
+    offset = 0;
+  }
+
+  if (position + p_size > free_until) wait_until_free(position + p_size);
+  if (position + p_size > free_until)
+  {
+    // Everything in flight belongs to the current frame and hasn't been
+    // fenced yet.
+    std::cerr << "ERROR::STREAM_BUFFER::FRAME_EXCEEDS_RING " << get_frame_bytes() + p_size << " bytes" << std::endl;
+    return nullptr;
+  }
+
+  head = position + p_size;
+  *r_offset = offset;
+
+  if (persistent_data) return persistent_data + offset;
+
+  p_state.bind_buffer(target, buffer);
+  mapped = true;
+  return glMapBufferRange(target, offset, p_size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+}
+
+void StreamBuffer::unmap(GLStateCache& p_state)
+{
+  if (!mapped) return;
+
+  p_state.bind_buffer(target, buffer);
+  glUnmapBuffer(target);
+  mapped = false;
+}
+
+void StreamBuffer::fence()
+{
+  if (head == fenced_head) return;
+
+  if (fence_count == MAX_FENCES)
+  {
+    // Too many small frames in flight, retire the oldest one.
+    wait_until_free(fences[fence_first].end + size);
+  }
+
+  Fence& fence = fences[(fence_first + fence_count) % MAX_FENCES];
+  fence.sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  fence.end = head;
+  fence_count++;
+  fenced_head = head;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "./gl_state_cache.h"
+
+#include <GL/glew.h>
+
+#include <cstdint>
+
+// Ring buffer for data written by the CPU every frame (uniforms, particles,
+// debug lines, UI). Writes go straight into mapped memory without implicit
+// synchronization, a fence per frame tells us when the GPU is done reading a
+// region so the ring only blocks if the GPU falls a whole buffer behind.
+// Uses a persistent, coherent mapping when ARB_buffer_storage is available,
+// otherwise maps each allocation with UNSYNCHRONIZED | INVALIDATE_RANGE.
+// Render thread only.
+class StreamBuffer
+{
+  public:
+  static constexpr int MAX_FENCES = 16;
+
+  void init(GLStateCache& p_state, GLenum p_target, GLsizeiptr p_size);
+  void destroy();
+
+  // Returns memory for p_size bytes and their offset in the buffer, or null
+  // if the request is larger than the ring. Must be followed by unmap()
+  // before GL reads from it.
+  void* map(GLStateCache& p_state, GLsizeiptr p_size, GLsizeiptr p_alignment, GLintptr* r_offset);
+  void unmap(GLStateCache& p_state);
+
+  // Call after the commands reading everything mapped so far were issued,
+  // usually once per frame.
+  void fence();
+
+  GLuint get_buffer() const { return buffer; }
+  GLsizeiptr get_size() const { return size; }
+  bool is_persistent() const { return persistent_data != nullptr; }
+
+  // Bytes mapped since the last fence.
+  GLsizeiptr get_frame_bytes() const { return (GLsizeiptr)(head - fenced_head); }
+
+  private:
+  void wait_until_free(uint64_t p_position);
+
+  GLenum target = 0;
+  GLuint buffer = 0;
+  GLsizeiptr size = 0;
+  unsigned char* persistent_data = nullptr;
+  bool mapped = false;
+
+  // Positions count bytes written since init() and only ever grow, the
+  // offset in the buffer is position % size.
+  uint64_t head = 0;
+  uint64_t fenced_head = 0;
+  uint64_t free_until = 0;
+
+  struct Fence
+  {
+    GLsync sync;
+    uint64_t end;
+  };
+  Fence fences[MAX_FENCES];
+  int fence_first = 0;
+  int fence_count = 0;
+};
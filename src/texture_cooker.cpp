@@ -0,0 +1,446 @@
+#include "./texture_cooker.h"
+
+#include "./utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+static constexpr uint32_t COOKED_MAGIC = 0x58455442; // "BTEX"
+static constexpr uint32_t COOKED_VERSION = 2;
+// Enough for any 32 bit texture size.
+static constexpr uint32_t MAX_LEVELS = 32;
+
+struct CookedHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t format;
+  uint32_t components;
+  uint32_t level_count;
+  uint32_t source_width;
+  uint32_t source_height;
+  uint32_t source_components;
+  uint64_t source_path_hash;
+  uint64_t source_content_hash;
+};
+
+// Header and level table in front of the texels, at most this large.
+static constexpr size_t MAX_HEADER_SIZE = sizeof(CookedHeader) + MAX_LEVELS * 3 * sizeof(uint32_t);
+
+TextureData TextureCooker::build_mips(const unsigned char* p_pixels, uint32_t p_width, uint32_t p_height, int p_components)
+{
+  TextureData data;
+  data.components = p_components;
+  if (p_components == 1)
+    data.format = GL_RED;
+  else if (p_components == 3)
+    data.format = GL_RGB;
+  else
+    data.format = GL_RGBA;
+
+  uint32_t width = p_width;
+  uint32_t height = p_height;
+  size_t total = 0;
+  while (true)
+  {
+    size_t size = (size_t)width * height * p_components;
+    data.levels.push_back({ width, height, total, size });
+    total += size;
+    if (width == 1 && height == 1) break;
+    width = std::max(1u, width / 2);
+    height = std::max(1u, height / 2);
+  }
+
+  data.pixels.resize(total);
+  std::memcpy(data.pixels.data(), p_pixels, data.levels[0].size);
+
+  for (size_t i = 1; i < data.levels.size(); ++i)
+  {
+    const TextureLevel& src_level = data.levels[i - 1];
+    const TextureLevel& dst_level = data.levels[i];
+    const unsigned char* src = data.pixels.data() + src_level.offset;
+    unsigned char* dst = data.pixels.data() + dst_level.offset;
+
+    for (uint32_t y = 0; y < dst_level.height; ++y)
+    {
+      uint32_t y0 = std::min(y * 2, src_level.height - 1);
+      uint32_t y1 = std::min(y * 2 + 1, src_level.height - 1);
+      for (uint32_t x = 0; x < dst_level.width; ++x)
+      {
+        uint32_t x0 = std::min(x * 2, src_level.width - 1);
+        uint32_t x1 = std::min(x * 2 + 1, src_level.width - 1);
+        for (int c = 0; c < p_components; ++c)
+        {
+          uint32_t sum = src[(y0 * src_level.width + x0) * p_components + c]
+              + src[(y0 * src_level.width + x1) * p_components + c]
+              + src[(y1 * src_level.width + x0) * p_components + c]
+              + src[(y1 * src_level.width + x1) * p_components + c];
+          dst[(y * dst_level.width + x) * p_components + c] = (unsigned char)((sum + 2) / 4);
+        }
+      }
+    }
+  }
+
+  return data;
+}
+
+static uint16_t pack_565(const float* p_color)
+{
+  int r = (int)(std::clamp(p_color[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+  int g = (int)(std::clamp(p_color[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+  int b = (int)(std::clamp(p_color[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+  return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpack_565(uint16_t p_color, int* r_color)
+{
+  int r = (p_color >> 11) & 31;
+  int g = (p_color >> 5) & 63;
+  int b = p_color & 31;
+  r_color[0] = (r << 3) | (r >> 2);
+  r_color[1] = (g << 2) | (g >> 4);
+  r_color[2] = (b << 3) | (b >> 2);
+}
+
+// Endpoints are the extremes of the block along its principal axis, found
+// with a few power iterations on the color covariance.
+static void encode_color_block(const unsigned char p_texels[16][4], unsigned char* r_block)
+{
+  float mean[3] = { 0.0f, 0.0f, 0.0f };
+  for (int i = 0; i < 16; ++i)
+    for (int c = 0; c < 3; ++c) mean[c] += p_texels[i][c] / 16.0f;
+
+  float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+  for (int i = 0; i < 16; ++i)
+  {
+    float r = p_texels[i][0] - mean[0];
+    float g = p_texels[i][1] - mean[1];
+    float b = p_texels[i][2] - mean[2];
+    cov[0] += r * r;
+    cov[1] += r * g;
+    cov[2] += r * b;
+    cov[3] += g * g;
+    cov[4] += g * b;
+    cov[5] += b * b;
+  }
+
+  float axis[3] = { 1.0f, 1.0f, 1.0f };
+  for (int iteration = 0; iteration < 4; ++iteration)
+  {
+    float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+    float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+    float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+    float length = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+    if (length < 1e-6f) break;
+    axis[0] = x / length;
+    axis[1] = y / length;
+    axis[2] = z / length;
+  }
+  float axis_length_sq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+  float min_t = 0.0f;
+  float max_t = 0.0f;
+  for (int i = 0; i < 16; ++i)
+  {
+    float t = ((p_texels[i][0] - mean[0]) * axis[0] + (p_texels[i][1] - mean[1]) * axis[1] + (p_texels[i][2] - mean[2]) * axis[2]) / axis_length_sq;
+    min_t = std::min(min_t, t);
+    max_t = std::max(max_t, t);
+  }
+
+  float end0[3];
+  float end1[3];
+  for (int c = 0; c < 3; ++c)
+  {
+    end0[c] = mean[c] + axis[c] * max_t;
+    end1[c] = mean[c] + axis[c] * min_t;
+  }
+
+  uint16_t color0 = pack_565(end0);
+  uint16_t color1 = pack_565(end1);
+  // color0 > color1 selects the four color mode.
+  if (color0 < color1) std::swap(color0, color1);
+
+  uint32_t indices = 0;
+  if (color0 != color1)
+  {
+    int palette[4][3];
+    unpack_565(color0, palette[0]);
+    unpack_565(color1, palette[1]);
+    for (int c = 0; c < 3; ++c)
+    {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    for (int i = 0; i < 16; ++i)
+    {
+      int best = 0;
+      int best_distance = INT32_MAX;
+      for (int p = 0; p < 4; ++p)
+      {
+        int dr = p_texels[i][0] - palette[p][0];
+        int dg = p_texels[i][1] - palette[p][1];
+        int db = p_texels[i][2] - palette[p][2];
+        int distance = dr * dr + dg * dg + db * db;
+        if (distance < best_distance)
+        {
+          best_distance = distance;
+          best = p;
+        }
+      }
+      indices |= (uint32_t)best << (i * 2);
+    }
+  }
+
+  r_block[0] = color0 & 0xFF;
+  r_block[1] = color0 >> 8;
+  r_block[2] = color1 & 0xFF;
+  r_block[3] = color1 >> 8;
+  for (int i = 0; i < 4; ++i) r_block[4 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+// Eight level alpha block between the block's min and max alpha.
+static void encode_alpha_block(const unsigned char p_texels[16][4], unsigned char* r_block)
+{
+  int alpha0 = 0;
+  int alpha1 = 255;
+  for (int i = 0; i < 16; ++i)
+  {
+    alpha0 = std::max(alpha0, (int)p_texels[i][3]);
+    alpha1 = std::min(alpha1, (int)p_texels[i][3]);
+  }
+
+  uint64_t indices = 0;
+  if (alpha0 != alpha1)
+  {
+    int palette[8];
+    palette[0] = alpha0;
+    palette[1] = alpha1;
+    for (int p = 2; p < 8; ++p) palette[p] = ((8 - p) * alpha0 + (p - 1) * alpha1) / 7;
+
+    for (int i = 0; i < 16; ++i)
+    {
+      int best = 0;
+      int best_distance = INT32_MAX;
+      for (int p = 0; p < 8; ++p)
+      {
+        int distance = std::abs(p_texels[i][3] - palette[p]);
+        if (distance < best_distance)
+        {
+          best_distance = distance;
+          best = p;
+        }
+      }
+      indices |= (uint64_t)best << (i * 3);
+    }
+  }
+
+  r_block[0] = (unsigned char)alpha0;
+  r_block[1] = (unsigned char)alpha1;
+  for (int i = 0; i < 6; ++i) r_block[2 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+TextureData TextureCooker::compress(const TextureData& p_source)
+{
+  if (p_source.compressed || (p_source.components != 3 && p_source.components != 4)) return p_source;
+
+  // Only pay for the alpha block if some texel isn't opaque.
+  bool has_alpha = false;
+  if (p_source.components == 4)
+  {
+    const TextureLevel& top = p_source.levels[0];
+    for (size_t i = 3; i < top.size && !has_alpha; i += 4) has_alpha = p_source.pixels[i] != 255;
+  }
+
+  TextureData data;
+  data.format = has_alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+  data.compressed = true;
+  data.components = p_source.components;
+  size_t block_size = has_alpha ? 16 : 8;
+
+  size_t total = 0;
+  for (const TextureLevel& level : p_source.levels)
+  {
+    size_t size = (size_t)((level.width + 3) / 4) * ((level.height + 3) / 4) * block_size;
+    data.levels.push_back({ level.width, level.height, total, size });
+    total += size;
+  }
+  data.pixels.resize(total);
+
+  int components = p_source.components;
+  for (size_t l = 0; l < p_source.levels.size(); ++l)
+  {
+    const TextureLevel& level = p_source.levels[l];
+    const unsigned char* src = p_source.pixels.data() + level.offset;
+    unsigned char* dst = data.pixels.data() + data.levels[l].offset;
+
+    for (uint32_t by = 0; by < level.height; by += 4)
+    {
+      for (uint32_t bx = 0; bx < level.width; bx += 4)
+      {
+        // Edge blocks repeat the last row/column.
+        unsigned char texels[16][4];
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+          uint32_t x = std::min(bx + (i & 3), level.width - 1);
+          uint32_t y = std::min(by + (i >> 2), level.height - 1);
+          const unsigned char* texel = src + (y * level.width + x) * components;
+          texels[i][0] = texel[0];
+          texels[i][1] = texel[1];
+          texels[i][2] = texel[2];
+          texels[i][3] = components == 4 ? texel[3] : 255;
+        }
+
+        if (has_alpha)
+        {
+          encode_alpha_block(texels, dst);
+          dst += 8;
+        }
+        encode_color_block(texels, dst);
+        dst += 8;
+      }
+    }
+  }
+
+  return data;
+}
+
+bool TextureCooker::save(const std::string& p_path, const TextureData& p_data, const TextureSource& p_source)
+{
+  std::ofstream file { p_path, std::ios::binary };
+  if (!file.is_open()) return false;
+
+  CookedHeader header { COOKED_MAGIC, COOKED_VERSION, p_data.format, (uint32_t)p_data.components, (uint32_t)p_data.levels.size(),
+    p_source.width, p_source.height, p_source.components, p_source.path_hash, p_source.content_hash };
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (const TextureLevel& level : p_data.levels)
+  {
+    uint32_t level_header[3] = { level.width, level.height, (uint32_t)level.size };
+    file.write(reinterpret_cast<const char*>(level_header), sizeof(level_header));
+  }
+  file.write(reinterpret_cast<const char*>(p_data.pixels.data()), p_data.pixels.size());
+  return file.good();
+}
+
+// Header and level table of a cooked file. Returns where the texels start,
+// 0 if the header is invalid.
+static size_t parse_header(const unsigned char* p_file, size_t p_size, TextureData& r_data, TextureSource& r_source)
+{
+  const unsigned char* read = p_file;
+  const unsigned char* end = p_file + p_size;
+  auto read_u32 = [&](uint32_t* r_value)
+  {
+    if (end - read < (ptrdiff_t)sizeof(uint32_t)) return false;
+    std::memcpy(r_value, read, sizeof(uint32_t));
+    read += sizeof(uint32_t);
+    return true;
+  };
+
+  CookedHeader header;
+  if (end - read < (ptrdiff_t)sizeof(header)) return 0;
+  std::memcpy(&header, read, sizeof(header));
+  read += sizeof(header);
+  if (header.magic != COOKED_MAGIC || header.version != COOKED_VERSION || header.level_count == 0 || header.level_count > MAX_LEVELS) return 0;
+
+  r_data.format = header.format;
+  r_data.compressed = r_data.format != GL_RED && r_data.format != GL_RGB && r_data.format != GL_RGBA;
+  r_data.components = (int)header.components;
+
+  size_t total = 0;
+  for (uint32_t i = 0; i < header.level_count; ++i)
+  {
+    uint32_t level_header[3];
+    for (uint32_t& value : level_header)
+      if (!read_u32(&value)) return 0;
+    r_data.levels.push_back({ level_header[0], level_header[1], total, level_header[2] });
+    total += level_header[2];
+  }
+
+  r_source = { header.source_path_hash, header.source_content_hash, header.source_width, header.source_height, header.source_components };
+  return read - p_file;
+}
+
+bool TextureCooker::load(const std::string& p_path, TextureData& r_data, TextureSource& r_source)
+{
+  TextureData data;
+  TextureSource source;
+  const AssetPack* pack = AssetPack::get_mounted();
+  const AssetPack::PackEntry* entry = pack != nullptr ? pack->find(p_path) : nullptr;
+  if (entry != nullptr)
+  {
+    unsigned char prefix[MAX_HEADER_SIZE];
+    size_t prefix_size = std::min<size_t>(entry->size, sizeof(prefix));
+    if (!pack->read_into(*entry, 0, prefix_size, prefix)) return false;
+
+    size_t texels = parse_header(prefix, prefix_size, data, source);
+    if (texels == 0) return false;
+    const TextureLevel& last = data.levels.back();
+    if (entry->size - texels < last.offset + last.size) return false;
+    data.pack = pack;
+    data.pack_entry = entry;
+    data.pack_offset = texels;
+  }
+  else
+  {
+    std::vector<unsigned char> file;
+    if (!Utils::read_file(p_path, file)) return false;
+
+    size_t texels = parse_header(file.data(), file.size(), data, source);
+    if (texels == 0) return false;
+    const TextureLevel& last = data.levels.back();
+    if (file.size() - texels < last.offset + last.size) return false;
+    data.pixels.assign(file.begin() + texels, file.begin() + texels + last.offset + last.size);
+  }
+
+  r_data = std::move(data);
+  r_source = source;
+  return true;
+}
+
+std::string TextureCooker::get_cache_path(const std::string& p_source_path, const std::string& p_cache_dir)
+{
+  char hash[17];
+  snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)AssetPack::hash_path(p_source_path));
+  return p_cache_dir + "/" + std::filesystem::path { p_source_path }.stem().string() + "-" + hash + ".btex";
+}
+
+TextureData TextureCooker::cook(const std::string& p_source_path, const std::string& p_cache_dir, const unsigned char* p_pixels, uint32_t p_width, uint32_t p_height, int p_components)
+{
+  namespace fs = std::filesystem;
+  std::error_code error;
+
+  std::string cache_path = get_cache_path(p_source_path, p_cache_dir);
+
+  TextureSource source;
+  source.path_hash = AssetPack::hash_path(p_source_path);
+  source.content_hash = Utils::hash_bytes(p_pixels, (size_t)p_width * p_height * p_components);
+  source.width = p_width;
+  source.height = p_height;
+  source.components = (uint32_t)p_components;
+
+  // A cache without a source next to it (e.g. shipped builds) is trusted.
+  bool stale = fs::exists(p_source_path, error) && fs::exists(cache_path, error)
+      && fs::last_write_time(cache_path, error) < fs::last_write_time(p_source_path, error);
+
+  TextureData data;
+  TextureSource cached;
+  if (!stale && load(cache_path, data, cached) && cached.path_hash == source.path_hash && cached.content_hash == source.content_hash
+      && cached.width == p_width && cached.height == p_height && cached.components == source.components)
+    return data;
+
+  data = compress(build_mips(p_pixels, p_width, p_height, p_components));
+  if (!data.compressed) return data;
+
+  fs::create_directories(p_cache_dir, error);
+  if (!save(cache_path, data, source))
+    std::cerr << "WARNING::TEXTURE_COOKER::CACHE_WRITE_FAILED " << cache_path << std::endl;
+  else
+    std::cerr << "TEXTURE_COOKER::COOKED " << cache_path << std::endl;
+
+  return data;
+}
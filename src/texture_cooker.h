@@ -0,0 +1,79 @@
+#pragma once
+
+#include "./asset_pack.h"
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct TextureLevel
+{
+  uint32_t width;
+  uint32_t height;
+  size_t offset;
+  size_t size;
+};
+
+// A texture with its full mip chain in one block of memory, either plain
+// 8 bit texels or BC blocks.
+struct TextureData
+{
+  // GL_RED/GL_RGB/GL_RGBA for uncompressed data, otherwise the compressed
+  // internal format.
+  GLenum format = GL_RGBA;
+  bool compressed = false;
+  int components = 4;
+  std::vector<unsigned char> pixels;
+  std::vector<TextureLevel> levels;
+
+  // Set instead of pixels for a cooked texture inside an asset pack. Level
+  // offsets then count from pack_offset in the entry, and each level is
+  // decoded from the pack when it is uploaded.
+  const AssetPack* pack = nullptr;
+  const AssetPack::PackEntry* pack_entry = nullptr;
+  size_t pack_offset = 0;
+};
+
+// What a cooked texture was made from, stored in its header so a cache entry
+// is only used for the exact source it was cooked from.
+struct TextureSource
+{
+  // AssetPack::hash_path() of the source path.
+  uint64_t path_hash = 0;
+  // Utils::hash_bytes() of the decoded source texels.
+  uint64_t content_hash = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t components = 0;
+};
+
+// Import-time texture processing. Builds mip chains and encodes them to BC1
+// (opaque) or BC3 (with alpha), and keeps the encoded result in a cache
+// directory so later runs only read the blocks back.
+class TextureCooker
+{
+  public:
+  // Box filtered mip chain down to 1x1.
+  static TextureData build_mips(const unsigned char* p_pixels, uint32_t p_width, uint32_t p_height, int p_components);
+
+  // BC1/BC3 for RGB/RGBA data. Single channel textures are returned as is.
+  static TextureData compress(const TextureData& p_source);
+
+  // Compressed texture for p_source_path from the cache in p_cache_dir, cooked
+  // from p_pixels if the cache is missing, older than the source or was cooked
+  // from different texels. Cache files are named after the full source path,
+  // so equally named images in different directories don't collide. Falls
+  // back to the uncompressed chain when the data can't be compressed.
+  static TextureData cook(const std::string& p_source_path, const std::string& p_cache_dir, const unsigned char* p_pixels, uint32_t p_width, uint32_t p_height, int p_components);
+
+  static std::string get_cache_path(const std::string& p_source_path, const std::string& p_cache_dir);
+
+  static bool save(const std::string& p_path, const TextureData& p_data, const TextureSource& p_source);
+
+  // A cache inside the mounted asset pack only has its header read, the
+  // texels stay in the pack (see TextureData::pack).
+  static bool load(const std::string& p_path, TextureData& r_data, TextureSource& r_source);
+};
@@ -0,0 +1,187 @@
+#include "./texture_streamer.h"
+
+#include "./memory_tracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+void TextureStreamer::init(GLStateCache& p_state, size_t p_budget_bytes, int p_uploads_per_frame)
+{
+  uploader.init(p_state, STAGING_SIZE);
+  budget = p_budget_bytes;
+  uploads_per_frame = p_uploads_per_frame;
+}
+
+void TextureStreamer::destroy()
+{
+  for (StreamedTexture& texture : textures) glDeleteTextures(1, &texture.id);
+  textures.clear();
+  free_slots.clear();
+  MemoryTracker::remove_gpu(MEMORY_TAG_ASSETS, resident_bytes);
+  resident_bytes = 0;
+  uploader.destroy();
+}
+
+size_t TextureStreamer::level_bytes(const StreamedTexture& p_texture, int p_level) const
+{
+  const TextureData& data = p_texture.data;
+  const TextureLevel& level = data.levels[p_level];
+  if (data.compressed) return level.size;
+
+  // Drivers pad RGB to four bytes per texel.
+  return (size_t)level.width * level.height * (data.components == 3 ? 4 : data.components);
+}
+
+uint32_t TextureStreamer::add(GLStateCache& p_state, TextureData p_data)
+{
+  StreamedTexture texture;
+  texture.data = std::move(p_data);
+  const std::vector<TextureLevel>& levels = texture.data.levels;
+
+  texture.min_level = (int)levels.size() - 1;
+  for (size_t i = 0; i < levels.size(); ++i)
+  {
+    if (std::max(levels[i].width, levels[i].height) <= MIN_RESIDENT_SIZE)
+    {
+      texture.min_level = (int)i;
+      break;
+    }
+  }
+
+  glGenTextures(1, &texture.id);
+  p_state.bind_texture(0, GL_TEXTURE_2D, texture.id);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (int)levels.size() - 1);
+
+  // Rows of the small mips aren't 4 byte aligned.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  // Smallest first, the texture is complete after every upload.
+  texture.resident_level = (int)levels.size();
+  for (int level = (int)levels.size() - 1; level >= texture.min_level; --level)
+  {
+    upload_level(p_state, texture, level);
+  }
+  texture.wanted_level = texture.min_level;
+
+  if (!free_slots.empty())
+  {
+    uint32_t slot = free_slots.back();
+    free_slots.pop_back();
+    textures[slot] = std::move(texture);
+    return slot;
+  }
+
+  textures.push_back(std::move(texture));
+  return (uint32_t)(textures.size() - 1);
+}
+
+void TextureStreamer::remove(uint32_t p_texture)
+{
+  StreamedTexture& texture = textures[p_texture];
+  for (int level = texture.resident_level; level < (int)texture.data.levels.size(); ++level)
+  {
+    size_t bytes = level_bytes(texture, level);
+    resident_bytes -= bytes;
+    MemoryTracker::remove_gpu(MEMORY_TAG_ASSETS, bytes);
+  }
+  glDeleteTextures(1, &texture.id);
+
+  // An empty slot is never picked for uploads or eviction.
+  texture = StreamedTexture {};
+  free_slots.push_back(p_texture);
+}
+
+void TextureStreamer::upload_level(GLStateCache& p_state, StreamedTexture& r_texture, int p_level)
+{
+  p_state.bind_texture(0, GL_TEXTURE_2D, r_texture.id);
+  uploader.upload(p_state, r_texture.data, p_level);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, p_level);
+
+  r_texture.resident_level = p_level;
+  size_t bytes = level_bytes(r_texture, p_level);
+  resident_bytes += bytes;
+  MemoryTracker::add_gpu(MEMORY_TAG_ASSETS, bytes);
+}
+
+void TextureStreamer::request(uint32_t p_texture, float p_screen_size)
+{
+  StreamedTexture& texture = textures[p_texture];
+  // Released slot, or a texture that failed to load.
+  if (texture.id == 0 || texture.data.levels.empty()) return;
+  const TextureLevel& top = texture.data.levels[0];
+
+  // One texel per pixel: each halving of the on-screen size drops a mip.
+  float ratio = std::max(top.width, top.height) / std::max(p_screen_size, 1.0f);
+  int level = ratio > 1.0f ? (int)std::floor(std::log2(ratio)) : 0;
+  level = std::min(level, texture.min_level);
+
+  if (texture.last_used != frame || level < texture.wanted_level) texture.wanted_level = level;
+  texture.last_used = frame;
+}
+
+bool TextureStreamer::evict_one(GLStateCache& p_state)
+{
+  // Oldest texture first. Textures used this frame only give up levels they
+  // no longer need.
+  StreamedTexture* victim = nullptr;
+  for (StreamedTexture& texture : textures)
+  {
+    if (texture.resident_level >= texture.min_level) continue;
+    if (texture.last_used == frame && texture.resident_level >= texture.wanted_level) continue;
+    if (victim == nullptr || texture.last_used < victim->last_used) victim = &texture;
+  }
+  if (victim == nullptr) return false;
+
+  int level = victim->resident_level;
+  p_state.bind_texture(0, GL_TEXTURE_2D, victim->id);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+  const TextureData& data = victim->data;
+  if (data.compressed)
+    glCompressedTexImage2D(GL_TEXTURE_2D, level, data.format, 0, 0, 0, 0, nullptr);
+  else
+    glTexImage2D(GL_TEXTURE_2D, level, data.format, 0, 0, 0, data.format, GL_UNSIGNED_BYTE, nullptr);
+
+  victim->resident_level = level + 1;
+  size_t bytes = level_bytes(*victim, level);
+  resident_bytes -= bytes;
+  MemoryTracker::remove_gpu(MEMORY_TAG_ASSETS, bytes);
+  return true;
+}
+
+void TextureStreamer::update(GLStateCache& p_state)
+{
+  for (int upload = 0; upload < uploads_per_frame; ++upload)
+  {
+    // Requested this frame and furthest from the wanted detail.
+    StreamedTexture* target = nullptr;
+    for (StreamedTexture& texture : textures)
+    {
+      if (texture.last_used != frame || texture.wanted_level >= texture.resident_level) continue;
+      if (target == nullptr || texture.resident_level - texture.wanted_level > target->resident_level - target->wanted_level) target = &texture;
+    }
+    if (target == nullptr) break;
+
+    size_t needed = level_bytes(*target, target->resident_level - 1);
+    bool fits = true;
+    while (resident_bytes + needed > budget)
+    {
+      if (!evict_one(p_state))
+      {
+        fits = false;
+        break;
+      }
+    }
+    if (!fits) break;
+
+    upload_level(p_state, *target, target->resident_level - 1);
+  }
+
+  // Covers this frame's uploads and those of textures added since the last
+  // update.
+  uploader.fence();
+  frame++;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "./gl_state_cache.h"
+#include "./texture_cooker.h"
+#include "./texture_uploader.h"
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// How large a streamed texture appears on screen this frame. Built by the
+// simulation, consumed by TextureStreamer::request().
+struct TextureRequest
+{
+  uint32_t texture = 0;
+  float screen_size = 0.0f;
+};
+
+// Keeps textures resident at the detail they are actually seen with. Only the
+// small mips are uploaded when a texture is added, higher mips follow a few
+// per frame as requests ask for them. Residency is capped by a byte budget;
+// when an upload would exceed it, the top mip of the least recently requested
+// texture is dropped. Mips are dropped by respecifying the level with zero
+// size and raising GL_TEXTURE_BASE_LEVEL, so the GL texture id never changes.
+// Uploads go through a TextureUploader and don't stall on the driver's copy.
+// Render thread only.
+class TextureStreamer
+{
+  public:
+  // Mips at or below this size are always resident.
+  static constexpr uint32_t MIN_RESIDENT_SIZE = 64;
+
+  // Staging holds a few frames of uploads, larger levels bypass it.
+  static constexpr GLsizeiptr STAGING_SIZE = 16 << 20;
+
+  void init(GLStateCache& p_state, size_t p_budget_bytes, int p_uploads_per_frame = 2);
+  void destroy();
+
+  // Takes a full mip chain, plain or compressed, see TextureCooker. Returns
+  // the index used by requests. Chains kept in an asset pack are decoded
+  // from it a level at a time as they stream in.
+  uint32_t add(GLStateCache& p_state, TextureData p_data);
+
+  // Deletes the GL texture and frees the slot for the next add().
+  void remove(uint32_t p_texture);
+
+  void request(uint32_t p_texture, float p_screen_size);
+
+  // Uploads and evicts mips based on this frame's requests.
+  void update(GLStateCache& p_state);
+
+  void set_budget(size_t p_budget_bytes) { budget = p_budget_bytes; }
+
+  GLuint get_gl_texture(uint32_t p_texture) const { return textures[p_texture].id; }
+  int get_resident_level(uint32_t p_texture) const { return textures[p_texture].resident_level; }
+  size_t get_resident_bytes() const { return resident_bytes; }
+  size_t get_budget() const { return budget; }
+
+  private:
+  struct StreamedTexture
+  {
+    GLuint id = 0;
+    TextureData data;
+
+    // Lowest (most detailed) level uploaded, and the one requests ask for.
+    int resident_level = 0;
+    int wanted_level = 0;
+    // Levels from here down are never evicted.
+    int min_level = 0;
+    uint64_t last_used = 0;
+  };
+
+  void upload_level(GLStateCache& p_state, StreamedTexture& r_texture, int p_level);
+  bool evict_one(GLStateCache& p_state);
+  size_t level_bytes(const StreamedTexture& p_texture, int p_level) const;
+
+  TextureUploader uploader;
+  std::vector<StreamedTexture> textures;
+  std::vector<uint32_t> free_slots;
+  size_t budget = 0;
+  size_t resident_bytes = 0;
+  int uploads_per_frame = 2;
+  uint64_t frame = 1;
+};
@@ -0,0 +1,93 @@
+#include "./texture_uploader.h"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Offsets handed to glTexImage2D, enough for any texel format.
+static constexpr GLsizeiptr STAGING_ALIGNMENT = 16;
+
+// Level p_level of a texture whose texels stay in an asset pack, decoded
+// straight into r_dst.
+static void read_level(const TextureData& p_data, int p_level, unsigned char* r_dst)
+{
+  const TextureLevel& level = p_data.levels[p_level];
+  if (p_data.pack->read_into(*p_data.pack_entry, p_data.pack_offset + level.offset, level.size, r_dst)) return;
+
+  // Still specify the level so the texture stays complete.
+  std::cerr << "ERROR::TEXTURE_UPLOADER::PACK_READ_FAILED level " << p_level << std::endl;
+  std::memset(r_dst, 0, level.size);
+}
+
+void TextureUploader::init(GLStateCache& p_state, GLsizeiptr p_staging_size)
+{
+  staging.init(p_state, GL_PIXEL_UNPACK_BUFFER, p_staging_size);
+
+  // The ring stays bound only while committing, client memory uploads
+  // elsewhere must not see it.
+  p_state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureUploader::destroy()
+{
+  staging.destroy();
+}
+
+unsigned char* TextureUploader::stage(GLStateCache& p_state, size_t p_size, GLintptr* r_offset)
+{
+  if ((GLsizeiptr)p_size > staging.get_size()) return nullptr;
+  void* memory = staging.map(p_state, (GLsizeiptr)p_size, STAGING_ALIGNMENT, r_offset);
+  p_state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  return static_cast<unsigned char*>(memory);
+}
+
+void TextureUploader::commit(GLStateCache& p_state, const TextureData& p_data, int p_level, GLintptr p_offset)
+{
+  const TextureLevel& level = p_data.levels[p_level];
+  staging.unmap(p_state);
+
+  // With an unpack buffer bound the pointer argument is an offset into it.
+  p_state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, staging.get_buffer());
+  const void* source = reinterpret_cast<const void*>(p_offset);
+  if (p_data.compressed)
+    glCompressedTexImage2D(GL_TEXTURE_2D, p_level, p_data.format, level.width, level.height, 0, (GLsizei)level.size, source);
+  else
+    glTexImage2D(GL_TEXTURE_2D, p_level, p_data.format, level.width, level.height, 0, p_data.format, GL_UNSIGNED_BYTE, source);
+  p_state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureUploader::upload(GLStateCache& p_state, const TextureData& p_data, int p_level)
+{
+  const TextureLevel& level = p_data.levels[p_level];
+
+  GLintptr offset;
+  unsigned char* memory = stage(p_state, level.size, &offset);
+  if (memory != nullptr)
+  {
+    if (p_data.pack_entry != nullptr)
+      read_level(p_data, p_level, memory);
+    else
+      std::memcpy(memory, p_data.pixels.data() + level.offset, level.size);
+    commit(p_state, p_data, p_level, offset);
+    return;
+  }
+
+  // Too large for the ring, from client memory.
+  const unsigned char* pixels;
+  std::vector<unsigned char> decoded;
+  if (p_data.pack_entry != nullptr)
+  {
+    decoded.resize(level.size);
+    read_level(p_data, p_level, decoded.data());
+    pixels = decoded.data();
+  }
+  else
+  {
+    pixels = p_data.pixels.data() + level.offset;
+  }
+
+  if (p_data.compressed)
+    glCompressedTexImage2D(GL_TEXTURE_2D, p_level, p_data.format, level.width, level.height, 0, (GLsizei)level.size, pixels);
+  else
+    glTexImage2D(GL_TEXTURE_2D, p_level, p_data.format, level.width, level.height, 0, p_data.format, GL_UNSIGNED_BYTE, pixels);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "./gl_state_cache.h"
+#include "./stream_buffer.h"
+#include "./texture_cooker.h"
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+// Texture uploads staged through a pixel unpack StreamBuffer. Level data is
+// copied into the ring and glTexImage2D sources it from a buffer offset, so
+// the driver's copy runs on the GPU timeline instead of blocking the call.
+// Staging memory is recycled once the fence of the frame that used it has
+// passed. Levels larger than the ring are uploaded from client memory.
+// Render thread only.
+class TextureUploader
+{
+  public:
+  void init(GLStateCache& p_state, GLsizeiptr p_staging_size);
+  void destroy();
+
+  // Mapped staging memory for p_size bytes, for callers that produce the
+  // data in place (e.g. AssetPack::read_into()). Null if it doesn't fit, in
+  // which case nothing needs to be committed.
+  unsigned char* stage(GLStateCache& p_state, size_t p_size, GLintptr* r_offset);
+
+  // Specifies level p_level of the bound GL_TEXTURE_2D from data staged at
+  // p_offset, in p_data's format.
+  void commit(GLStateCache& p_state, const TextureData& p_data, int p_level, GLintptr p_offset);
+
+  // stage() and commit() of level p_level of p_data, with the fallback.
+  // Levels of a texture kept in an asset pack are decoded into the staging
+  // memory directly.
+  void upload(GLStateCache& p_state, const TextureData& p_data, int p_level);
+
+  // Once per frame after the frame's uploads.
+  void fence() { staging.fence(); }
+
+  GLsizeiptr get_frame_bytes() const { return staging.get_frame_bytes(); }
+
+  private:
+  StreamBuffer staging;
+};
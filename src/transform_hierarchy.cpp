@@ -0,0 +1,136 @@
+#include "./transform_hierarchy.h"
+
+#if defined(__SSE__)
+  #include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+  #include <arm_neon.h>
+#endif
+
+// r = a * b for column major 4x4 matrices. Each result column is a linear
+// combination of a's columns, which maps directly onto 4-wide SIMD.
+static inline void multiply(const glm::mat4& p_a, const glm::mat4& p_b, glm::mat4& r_result)
+{
+  const float* a = &p_a[0][0];
+  const float* b = &p_b[0][0];
+  float* r = &r_result[0][0];
+
+#if defined(__SSE__)
+  __m128 a0 = _mm_loadu_ps(a);
+  __m128 a1 = _mm_loadu_ps(a + 4);
+  __m128 a2 = _mm_loadu_ps(a + 8);
+  __m128 a3 = _mm_loadu_ps(a + 12);
+  for (int column = 0; column < 4; ++column)
+  {
+    const float* bc = b + column * 4;
+    __m128 sum = _mm_mul_ps(a0, _mm_set1_ps(bc[0]));
+    sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_set1_ps(bc[1])));
+    sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(bc[2])));
+    sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(bc[3])));
+    _mm_storeu_ps(r + column * 4, sum);
+  }
+#elif defined(__ARM_NEON)
+  float32x4_t a0 = vld1q_f32(a);
+  float32x4_t a1 = vld1q_f32(a + 4);
+  float32x4_t a2 = vld1q_f32(a + 8);
+  float32x4_t a3 = vld1q_f32(a + 12);
+  for (int column = 0; column < 4; ++column)
+  {
+    float32x4_t bc = vld1q_f32(b + column * 4);
+    float32x4_t sum = vmulq_laneq_f32(a0, bc, 0);
+    sum = vfmaq_laneq_f32(sum, a1, bc, 1);
+    sum = vfmaq_laneq_f32(sum, a2, bc, 2);
+    sum = vfmaq_laneq_f32(sum, a3, bc, 3);
+    vst1q_f32(r + column * 4, sum);
+  }
+#else
+  r_result = p_a * p_b;
+  (void)a;
+  (void)b;
+  (void)r;
+#endif
+}
+
+uint32_t TransformHierarchy::create(uint32_t p_parent)
+{
+  uint32_t node = (uint32_t)parents.size();
+  parents.push_back(p_parent);
+  locals.push_back(glm::mat4 { 1.0f });
+  worlds.push_back(glm::mat4 { 1.0f });
+  dirty.push_back(0);
+  changed_in.push_back(0);
+  mark_dirty(node);
+  return node;
+}
+
+void TransformHierarchy::clear()
+{
+  parents.clear();
+  locals.clear();
+  worlds.clear();
+  dirty.clear();
+  changed_in.clear();
+  first_dirty = NONE;
+}
+
+void TransformHierarchy::truncate(uint32_t p_count)
+{
+  if (p_count >= parents.size()) return;
+  parents.resize(p_count);
+  locals.resize(p_count);
+  worlds.resize(p_count);
+  dirty.resize(p_count);
+  changed_in.resize(p_count);
+  if (first_dirty != NONE && first_dirty >= p_count) first_dirty = NONE;
+}
+
+void TransformHierarchy::mark_dirty(uint32_t p_node)
+{
+  dirty[p_node] = 1;
+  if (p_node < first_dirty) first_dirty = p_node;
+}
+
+void TransformHierarchy::set_local(uint32_t p_node, const glm::mat4& p_local)
+{
+  locals[p_node] = p_local;
+  mark_dirty(p_node);
+}
+
+void TransformHierarchy::set_position(uint32_t p_node, const glm::vec3& p_position)
+{
+  glm::vec4& translation = locals[p_node][3];
+  if (translation.x == p_position.x && translation.y == p_position.y && translation.z == p_position.z) return;
+
+  translation = glm::vec4 { p_position, 1.0f };
+  mark_dirty(p_node);
+}
+
+void TransformHierarchy::update()
+{
+  updated_count = 0;
+  if (first_dirty == NONE) return;
+
+  update_index++;
+  uint32_t count = (uint32_t)parents.size();
+  const uint32_t* parent = parents.data();
+  uint8_t* dirty_flags = dirty.data();
+  uint32_t* changed = changed_in.data();
+
+  // Nothing before the first dirty node can change, parents come first.
+  for (uint32_t i = first_dirty; i < count; ++i)
+  {
+    uint32_t p = parent[i];
+    bool parent_changed = p != NONE && changed[p] == update_index;
+    if (!dirty_flags[i] && !parent_changed) continue;
+
+    if (p == NONE)
+      worlds[i] = locals[i];
+    else
+      multiply(worlds[p], locals[i], worlds[i]);
+
+    dirty_flags[i] = 0;
+    changed[i] = update_index;
+    updated_count++;
+  }
+
+  first_dirty = NONE;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Scene graph transforms stored as parallel arrays, sorted so every parent
+// comes before its children. update() is then a single forward pass that only
+// recomputes world matrices of nodes whose local matrix changed or whose
+// parent was recomputed, starting at the first dirty node, so static parts of
+// the scene cost nothing.
+class TransformHierarchy
+{
+  public:
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  // p_parent must already exist, which keeps parents ahead of children.
+  uint32_t create(uint32_t p_parent = NONE);
+  void clear();
+
+  // Drops every node from p_count on, e.g. a level's static nodes created
+  // after the persistent ones. Children always come after their parents, so
+  // the rest stays intact.
+  void truncate(uint32_t p_count);
+
+  void set_local(uint32_t p_node, const glm::mat4& p_local);
+  void set_position(uint32_t p_node, const glm::vec3& p_position);
+
+  const glm::mat4& get_local(uint32_t p_node) const { return locals[p_node]; }
+  const glm::mat4& get_world(uint32_t p_node) const { return worlds[p_node]; }
+  uint32_t get_parent(uint32_t p_node) const { return parents[p_node]; }
+  uint32_t get_count() const { return (uint32_t)parents.size(); }
+
+  // World matrices recomputed by the last update().
+  uint32_t get_updated_count() const { return updated_count; }
+
+  void update();
+
+  private:
+  void mark_dirty(uint32_t p_node);
+
+  std::vector<uint32_t> parents;
+  std::vector<glm::mat4> locals;
+  std::vector<glm::mat4> worlds;
+  std::vector<uint8_t> dirty;
+
+  // Update index a node's world matrix last changed in, lets children check
+  // their parent without clearing flags every frame.
+  std::vector<uint32_t> changed_in;
+
+  uint32_t first_dirty = NONE;
+  uint32_t update_index = 1;
+  uint32_t updated_count = 0;
+};
@@ -0,0 +1,68 @@
+#include "./uniform_buffers.h"
+#include "./render_thread.h"
+
+#include <cstring>
+#include <iostream>
+
+void UniformBuffers::init(GLStateCache& p_state)
+{
+  GLint ubo_alignment = 256;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &ubo_alignment);
+  alignment = ubo_alignment;
+  object_stride = (sizeof(ObjectUniforms) + alignment - 1) / alignment * alignment;
+
+  ring.init(p_state, GL_UNIFORM_BUFFER, RING_SIZE);
+}
+
+void UniformBuffers::bind_program_blocks(GLuint p_program)
+{
+  GLuint frame_block = glGetUniformBlockIndex(p_program, "FrameData");
+  if (frame_block != GL_INVALID_INDEX) glUniformBlockBinding(p_program, frame_block, UNIFORM_BINDING_FRAME);
+
+  GLuint object_block = glGetUniformBlockIndex(p_program, "ObjectData");
+  if (object_block != GL_INVALID_INDEX) glUniformBlockBinding(p_program, object_block, UNIFORM_BINDING_OBJECT);
+}
+
+void UniformBuffers::upload(GLStateCache& p_state, const FrameUniforms& p_frame, const RenderObject* p_objects, size_t p_object_count)
+{
+  if (p_object_count > MAX_OBJECTS)
+  {
+    std::cerr << "WARNING::UNIFORM_BUFFERS::TOO_MANY_OBJECTS " << p_object_count << std::endl;
+    p_object_count = MAX_OBJECTS;
+  }
+
+  GLintptr frame_offset = 0;
+  if (void* data = ring.map(p_state, sizeof(FrameUniforms), alignment, &frame_offset))
+  {
+    memcpy(data, &p_frame, sizeof(FrameUniforms));
+    ring.unmap(p_state);
+    p_state.bind_buffer_range(GL_UNIFORM_BUFFER, UNIFORM_BINDING_FRAME, ring.get_buffer(), frame_offset, sizeof(FrameUniforms));
+  }
+
+  object_count = 0;
+  if (p_object_count == 0) return;
+
+  unsigned char* data = static_cast<unsigned char*>(ring.map(p_state, object_stride * p_object_count, alignment, &object_offset));
+  if (!data) return;
+
+  for (size_t i = 0; i < p_object_count; ++i)
+  {
+    ObjectUniforms object { p_objects[i].model, p_objects[i].color };
+    memcpy(data + object_stride * i, &object, sizeof(ObjectUniforms));
+  }
+  ring.unmap(p_state);
+  object_count = p_object_count;
+}
+
+bool UniformBuffers::bind_object(GLStateCache& p_state, uint32_t p_object)
+{
+  if (p_object >= object_count) return false;
+
+  p_state.bind_buffer_range(GL_UNIFORM_BUFFER, UNIFORM_BINDING_OBJECT, ring.get_buffer(), object_offset + object_stride * p_object, sizeof(ObjectUniforms));
+  return true;
+}
+
+void UniformBuffers::end_frame()
+{
+  ring.fence();
+}
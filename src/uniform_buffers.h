@@ -0,0 +1,67 @@
+#pragma once
+
+#include "./gl_state_cache.h"
+#include "./stream_buffer.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+struct RenderObject;
+
+// Fixed binding points, shared by every program. See bind_program_blocks().
+enum UniformBinding
+{
+  UNIFORM_BINDING_FRAME,
+  UNIFORM_BINDING_OBJECT,
+};
+
+// std140 layout of the FrameData block.
+struct FrameUniforms
+{
+  glm::mat4 view;
+  glm::mat4 projection;
+  float time;
+  float pad[3];
+};
+
+// std140 layout of the ObjectData block.
+struct ObjectUniforms
+{
+  glm::mat4 model;
+  glm::vec4 color;
+};
+
+// Per-frame and per-object uniform data in UBOs. The frame block is bound
+// once per frame, object data for all draws is written in one go and each
+// draw selects its slot with bind_object(), so switching programs doesn't
+// require re-sending anything. Both live in a streaming ring buffer.
+// Render thread only.
+class UniformBuffers
+{
+  public:
+  static constexpr uint32_t MAX_OBJECTS = 4096;
+  static constexpr GLsizeiptr RING_SIZE = 4 << 20;
+
+  void init(GLStateCache& p_state);
+
+  // Point a program's FrameData/ObjectData blocks at the shared bindings.
+  static void bind_program_blocks(GLuint p_program);
+
+  void upload(GLStateCache& p_state, const FrameUniforms& p_frame, const RenderObject* p_objects, size_t p_object_count);
+
+  // False if the object didn't fit into this frame's upload.
+  bool bind_object(GLStateCache& p_state, uint32_t p_object);
+
+  // After the frame's draws were issued.
+  void end_frame();
+
+  private:
+  StreamBuffer ring;
+  GLsizeiptr alignment = 256;
+  GLsizeiptr object_stride = 0;
+  GLintptr object_offset = 0;
+  uint32_t object_count = 0;
+};
@@ -1,26 +1,58 @@
 #include "./utils.h"
 
+#include "./asset_pack.h"
+
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <iterator>
 
 std::string Utils::load_file_source(const char* p_filepath)
 {
-  std::fstream file_stream { p_filepath, std::ios::in };
-  std::string content, line = "";
-
-  if (!file_stream.is_open())
+  std::vector<unsigned char> content;
+  if (!read_file(p_filepath, content))
   {
     std::cout << "FILE::READ::FAILED " << p_filepath << std::endl;
     exit(EXIT_FAILURE);
   }
 
-  while (!file_stream.eof())
+  return std::string { content.begin(), content.end() };
+}
+
+bool Utils::read_file(const std::string& p_filepath, std::vector<unsigned char>& r_content)
+{
+  const AssetPack* pack = AssetPack::get_mounted();
+  if (pack != nullptr && pack->read(p_filepath, r_content)) return true;
+
+  std::ifstream file_stream { p_filepath, std::ios::binary };
+  if (!file_stream.is_open()) return false;
+
+  r_content.assign(std::istreambuf_iterator<char> { file_stream }, std::istreambuf_iterator<char> {});
+  return true;
+}
+
+bool Utils::file_exists(const std::string& p_filepath)
+{
+  const AssetPack* pack = AssetPack::get_mounted();
+  if (pack != nullptr && pack->find(p_filepath) != nullptr) return true;
+
+  std::ifstream file_stream { p_filepath, std::ios::binary };
+  return file_stream.is_open();
+}
+
+uint64_t Utils::hash_string(const std::string& p_string)
+{
+  return hash_bytes(p_string.data(), p_string.size());
+}
+
+uint64_t Utils::hash_bytes(const void* p_data, size_t p_size)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(p_data);
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < p_size; ++i)
   {
-    getline(file_stream, line);
-    content.append(line + "\n");
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
   }
-
-  file_stream.close();
-  return content;
+  return hash;
 }
@@ -1,9 +1,20 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 class Utils
 {
   public:
   static std::string load_file_source(const char* p_filepath);
+
+  // Whole file, from the mounted AssetPack if it has it, otherwise from disk.
+  static bool read_file(const std::string& p_filepath, std::vector<unsigned char>& r_content);
+  static bool file_exists(const std::string& p_filepath);
+
+  // 64 bit FNV-1a, for keying assets by path.
+  static uint64_t hash_string(const std::string& p_string);
+  static uint64_t hash_bytes(const void* p_data, size_t p_size);
 };
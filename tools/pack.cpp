@@ -0,0 +1,157 @@
+// Builds an AssetPack from files and directories.
+//
+//   pack <output.pak> <path>...
+//
+// Directories are added recursively. Entries are keyed by their normalized
+// path as given, so run it from the repository root with "res" to get the
+// keys the game looks up ("res/models/...").
+
+#include "../src/asset_pack.h"
+#include "../src/compression.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct PendingEntry
+{
+  std::string path;
+  AssetPack::PackEntry entry;
+  std::vector<unsigned char> stored;
+};
+
+// Keep compression only where it pays for the decode.
+static constexpr double MIN_SAVING = 0.1;
+
+static bool add_file(const fs::path& p_path, std::vector<PendingEntry>& r_entries)
+{
+  std::ifstream file { p_path, std::ios::binary };
+  if (!file.is_open())
+  {
+    std::cerr << "ERROR::PACK::READ_FAILED " << p_path.string() << std::endl;
+    return false;
+  }
+  std::vector<unsigned char> content { std::istreambuf_iterator<char> { file }, std::istreambuf_iterator<char> {} };
+
+  PendingEntry pending;
+  pending.path = AssetPack::normalize_path(p_path.generic_string());
+  pending.entry = {};
+  pending.entry.hash = AssetPack::hash_path(pending.path);
+  pending.entry.size = (uint32_t)content.size();
+
+  // Large entries in independent blocks, so loading can spread them over
+  // the job system.
+  std::vector<unsigned char> compressed;
+  uint32_t flags = 0;
+  if (content.size() > 2 * AssetPack::BLOCK_SIZE)
+  {
+    compressed = AssetPack::compress_blocked(content.data(), content.size());
+    flags = AssetPack::ENTRY_BLOCKED;
+  }
+  else
+  {
+    compressed.resize(Compression::get_bound(content.size()));
+    compressed.resize(Compression::compress(content.data(), content.size(), compressed.data(), compressed.size()));
+    flags = AssetPack::ENTRY_COMPRESSED;
+  }
+
+  if (!compressed.empty() && compressed.size() < content.size() * (1.0 - MIN_SAVING))
+  {
+    pending.stored = std::move(compressed);
+    pending.entry.flags = flags;
+  }
+  else
+  {
+    pending.stored = std::move(content);
+  }
+  pending.entry.stored_size = (uint32_t)pending.stored.size();
+
+  r_entries.push_back(std::move(pending));
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "usage: pack <output.pak> <path>..." << std::endl;
+    return 1;
+  }
+
+  std::vector<PendingEntry> entries;
+  for (int i = 2; i < argc; ++i)
+  {
+    fs::path root { argv[i] };
+    if (fs::is_directory(root))
+    {
+      for (const fs::directory_entry& item : fs::recursive_directory_iterator { root })
+      {
+        if (item.is_regular_file() && !add_file(item.path(), entries)) return 1;
+      }
+    }
+    else if (!add_file(root, entries))
+    {
+      return 1;
+    }
+  }
+
+  std::sort(entries.begin(), entries.end(), [](const PendingEntry& p_a, const PendingEntry& p_b) { return p_a.entry.hash < p_b.entry.hash; });
+  for (size_t i = 1; i < entries.size(); ++i)
+  {
+    if (entries[i].entry.hash == entries[i - 1].entry.hash)
+    {
+      std::cerr << "ERROR::PACK::HASH_COLLISION " << entries[i - 1].path << " " << entries[i].path << std::endl;
+      return 1;
+    }
+  }
+
+  // Data starts after the index, every entry aligned.
+  uint64_t offset = sizeof(AssetPack::PackHeader) + entries.size() * sizeof(AssetPack::PackEntry);
+  for (PendingEntry& pending : entries)
+  {
+    offset = (offset + AssetPack::ALIGNMENT - 1) & ~(uint64_t)(AssetPack::ALIGNMENT - 1);
+    pending.entry.offset = offset;
+    offset += pending.stored.size();
+  }
+
+  std::ofstream out { argv[1], std::ios::binary };
+  if (!out.is_open())
+  {
+    std::cerr << "ERROR::PACK::WRITE_FAILED " << argv[1] << std::endl;
+    return 1;
+  }
+
+  AssetPack::PackHeader header {};
+  header.magic = AssetPack::MAGIC;
+  header.version = AssetPack::VERSION;
+  header.entry_count = (uint32_t)entries.size();
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (const PendingEntry& pending : entries) out.write(reinterpret_cast<const char*>(&pending.entry), sizeof(pending.entry));
+
+  size_t raw_bytes = 0;
+  size_t stored_bytes = 0;
+  for (const PendingEntry& pending : entries)
+  {
+    static const char zeros[AssetPack::ALIGNMENT] = {};
+    out.write(zeros, pending.entry.offset - (uint64_t)out.tellp());
+    out.write(reinterpret_cast<const char*>(pending.stored.data()), pending.stored.size());
+    raw_bytes += pending.entry.size;
+    stored_bytes += pending.entry.stored_size;
+  }
+
+  if (!out.good())
+  {
+    std::cerr << "ERROR::PACK::WRITE_FAILED " << argv[1] << std::endl;
+    return 1;
+  }
+
+  std::cout << entries.size() << " entries, " << raw_bytes << " -> " << stored_bytes << " bytes" << std::endl;
+  return 0;
+}